@@ -5,6 +5,21 @@
 #include <locale>
 #include <random>
 #include <algorithm>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cctype>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <csignal>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
 
 using std::__cxx11::collate;
 
@@ -12,15 +27,150 @@ using std::__cxx11::collate;
 
 #define CMakeLists "CMakeLists.txt"
 
+//multi-config generators place outputs of each configuration into build/<profile>/<config>
+#define OUTPUT_DIR_DEFINITION \
+         "get_property(IS_MULTI_CONFIG GLOBAL PROPERTY GENERATOR_IS_MULTI_CONFIG)\n" \
+         "if(IS_MULTI_CONFIG)\n" \
+         "\tset(OUTPUT_DIR ${CMAKE_BINARY_DIR}/$<LOWER_CASE:$<CONFIG>>)\n" \
+         "else()\n" \
+         "\tset(OUTPUT_DIR ${CMAKE_BINARY_DIR})\n" \
+         "endif()\n"
+
+//the Makefile passes the build profile to each configuration, it is read by import_library() and MultiIsa.cmake
+#define BUILD_PROFILE_FILE_LINE "set(BUILD_PROFILE_FILE \"\" CACHE FILEPATH \"Build profile of the tree\")"
+#define BUILD_PROFILE_FILE_DEFINITION BUILD_PROFILE_FILE_LINE "\n"
+
 static std::filesystem::path src("src");
 static std::filesystem::path src_tests("src/tests");
+static std::filesystem::path src_cxxbench("src/cxxbench");
+static std::filesystem::path src_cxxtest("src/cxxtest");
+static std::filesystem::path src_cxxtrace("src/cxxtrace");
 static std::filesystem::path conf("conf");
 static std::filesystem::path log_path("log");
 static std::filesystem::path build("build");
-static std::filesystem::path build_debug = build/"debug";
-static std::filesystem::path build_release = build/"release";
+static std::filesystem::path cmake_modules("cmake");
+static std::filesystem::path profiles("profiles");
+
+enum class Generator {
+    ///Two single-configuration trees build/<profile>/debug and build/<profile>/release (Unix Makefiles)
+    make,
+    ///One Ninja Multi-Config tree in build/<profile>, outputs are placed into its debug and release
+    ninja
+};
+
+enum class LibraryKind {
+    ///Static library (archive)
+    static_lib,
+    ///Object files linked directly into consumers, no archive step
+    object,
+    ///Shared library exporting only symbols marked by export macro
+    shared,
+    ///Header-only library without sources
+    interface
+};
+
+///Options of a library imported from git
+struct SubmoduleOptions {
+    ///Count of fetched commits (0 - full history)
+    unsigned int depth = 0;
+    ///Count of nested submodules fetched in parallel (0 - default of git)
+    unsigned int jobs = 0;
+};
+
+///Options of a generated target
+struct TargetOptions {
+    ///Target is built as unity (jumbo) build
+    bool unity = false;
+    ///All test files of a tests directory are compiled into one executable
+    bool single_binary = false;
+    ///Kind of a library target
+    LibraryKind kind = LibraryKind::static_lib;
+    ///Library is C++20 module instead of a header
+    bool modules = false;
+    ///Executable is instrumented by the tracing library src/cxxtrace
+    bool tracing = false;
+};
+
+static Generator parse_generator(std::string_view name) {
+    if (name == "make" || name == "makefiles") return Generator::make;
+    if (name == "ninja") return Generator::ninja;
+    throw std::runtime_error(std::string("Unknown generator: ").append(name).append(" (expected: make or ninja)"));
+}
+
+static LibraryKind parse_library_kind(std::string_view name) {
+    if (name == "static") return LibraryKind::static_lib;
+    if (name == "object") return LibraryKind::object;
+    if (name == "shared") return LibraryKind::shared;
+    if (name == "interface") return LibraryKind::interface;
+    throw std::runtime_error(std::string("Unknown library kind: ").append(name).append(" (expected: static, object, shared or interface)"));
+}
+
+///Detects generator of an existing project from its Makefile
+static Generator detect_generator() {
+    std::ifstream in("Makefile");
+    std::string ln;
+    while (std::getline(in, ln)) {
+        if (ln.find("Ninja Multi-Config") != ln.npos) return Generator::ninja;
+    }
+    return Generator::make;
+}
+
+//directories of build trees are $(BUILD_DIR)/<dir>, which is build/<profile>/<dir>
+static void makefile_build_dir_rules(std::ostream &f, const std::string &dir) {
+    f << dir << "/conf: | " << dir << " conf \n"
+         "\tcd " << dir << "; ln -s ../../../conf conf\n"
+         "\n"
+      << dir << "/data: | " << dir << " data \n"
+         "\tcd " << dir << "; ln -s ../../../data data\n"
+         "\n"
+      << dir << "/log: | " << dir << "\n"
+         "\tmkdir " << dir << "/log\n"
+         "\n"
+      << dir << ":\n"
+         "\t@mkdir -p " << dir << "\n"
+         "\n";
+}
+
+///Generates recipe, which builds a target of the generated CMake project in given configuration
+static std::string build_command(Generator gen, std::string_view config, std::string_view target) {
+    std::string out;
+    if (gen == Generator::ninja) {
+        out.append("\t@cmake --build $(BUILD_DIR) --config ").append(config).append(" --target ").append(target).append("\n");
+    } else {
+        std::string dir(config);
+        std::transform(dir.begin(), dir.end(), dir.begin(), tolower);
+        out.append("\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/").append(dir).append(" ").append(target).append("\n");
+    }
+    return out;
+}
+
+///Generates rule, which configures an additional single-configuration tree
+static void makefile_aux_tree(std::ostream &f, Generator gen, std::string_view dir, std::string_view build_type, std::string_view args) {
+    f << dir << "/CMakeCache.txt: $(BUILD_PROFILE) | $(FORCE_BUILD_PROFILE)\n"
+         "\trm -f " << dir << "/CMakeCache.txt\n"
+         "\tcmake -G " << (gen == Generator::ninja?"Ninja":"\"Unix Makefiles\"")
+      << " -S . -B " << dir << " -DCMAKE_BUILD_TYPE=" << build_type
+      << " `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)` " << args << "\n"
+         "\n";
+}
+
+///Generates command, which builds a target in an additional single-configuration tree
+static std::string aux_build(Generator gen, std::string_view dir, std::string_view target) {
+    std::string out;
+    if (gen == Generator::ninja) {
+        out.append("cmake --build ").append(dir).append(" --target ").append(target);
+    } else {
+        out.append("$(MAKE) --no-print-directory -C ").append(dir).append(" ").append(target);
+    }
+    return out;
+}
+
+///Generates recipe, which builds a target in an additional single-configuration tree
+static std::string aux_build_command(Generator gen, std::string_view dir, std::string_view target) {
+    return "\t@" + aux_build(gen, dir, target) + "\n";
+}
 
-static void install_makefile() {
+static void install_makefile(Generator gen) {
     std::ofstream f("Makefile", std::ios::out|std::ios::trunc);
     f <<
 "ifdef BUILD_PROFILE\n"
@@ -34,65 +184,189 @@ static void install_makefile() {
     "\tBUILD_PROFILE=default_build_profile.conf\n"
 "endif\n"
 "\n"
+//BUILD_PROFILE=<name> selects profiles/<name>.conf, BUILD_PROFILE=default selects default_build_profile.conf
+"ifeq ($(wildcard $(BUILD_PROFILE)),)\n"
+"ifneq ($(wildcard profiles/$(BUILD_PROFILE).conf),)\n"
+    "\toverride BUILD_PROFILE:=profiles/$(BUILD_PROFILE).conf\n"
+"else ifneq ($(wildcard $(BUILD_PROFILE)_build_profile.conf),)\n"
+    "\toverride BUILD_PROFILE:=$(BUILD_PROFILE)_build_profile.conf\n"
+"endif\n"
+"endif\n"
+"\n"
+//each profile has own build trees, so switching profiles doesn't rebuild anything
+"PROFILE_NAME:=$(patsubst %_build_profile,%,$(basename $(notdir $(BUILD_PROFILE))))\n"
+"BUILD_DIR:=build/$(PROFILE_NAME)\n"
+//build/current is used by the commands of cxxproject, it follows the profile of each build
+"CURRENT_LINK=test \"`readlink build/current`\" = \"$(PROFILE_NAME)\" || ln -sfn $(PROFILE_NAME) build/current\n"
+"TEST_JOBS ?= $(shell nproc 2>/dev/null || echo 1)\n"
+"\n";
+    if (gen == Generator::ninja) {
+        f <<
+//ninja runs its own jobs in parallel, both configurations share one build tree
+".NOTPARALLEL:\n"
+"\n"
+"all : all_debug all_release\n"
+"all_debug: $(BUILD_DIR)/build.ninja\n"
+    "\t@$(CURRENT_LINK)\n"
+    "\t@cmake --build $(BUILD_DIR) --config Debug\n"
+"all_release: $(BUILD_DIR)/build.ninja\n"
+    "\t@$(CURRENT_LINK)\n"
+    "\t@cmake --build $(BUILD_DIR) --config Release\n"
+"clean:\n"
+    "\t@cmake --build $(BUILD_DIR) --config Debug --target clean\n"
+    "\t@cmake --build $(BUILD_DIR) --config Release --target clean\n"
+"install: $(BUILD_DIR)/build.ninja\n"
+    "\t@cmake --build $(BUILD_DIR) --config Release --target install\n"
+"test: all_release\n"
+    "\t@cd $(BUILD_DIR) && ctest -C Release -j$(TEST_JOBS)\n"
+"\n"
+"$(FORCE_BUILD_PROFILE):\n"
+    "\techo $(FORCE_BUILD_PROFILE)\n"
+    "\t$(file >.current_profile.mk,BUILD_PROFILE=$(BUILD_PROFILE))\n"
+    "\t@mkdir -p build && $(CURRENT_LINK)\n"
+"\n"
+"$(BUILD_DIR)/build.ninja: $(BUILD_PROFILE) | $(FORCE_BUILD_PROFILE) $(BUILD_DIR)/debug/conf $(BUILD_DIR)/debug/log $(BUILD_DIR)/debug/data $(BUILD_DIR)/release/conf $(BUILD_DIR)/release/log $(BUILD_DIR)/release/data\n"
+            //this is necesary as the cmake regenerates cache with old values
+    "\trm -f $(BUILD_DIR)/CMakeCache.txt\n"
+    "\tcmake -G \"Ninja Multi-Config\" -S . -B $(BUILD_DIR) \"-DCMAKE_CONFIGURATION_TYPES=Debug;Release\" `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)` -DBUILD_PROFILE_FILE=$(CURDIR)/$(BUILD_PROFILE)\n"
+"\n";
+    } else {
+        f <<
 "all : all_debug all_release\n"
-"all_debug: build/debug/Makefile\n"
-    "\t@$(MAKE) --no-print-directory -C build/debug all\n"
-"all_release: build/release/Makefile\n"
-    "\t@$(MAKE) --no-print-directory -C build/release all\n"
+"all_debug: $(BUILD_DIR)/debug/Makefile\n"
+    "\t@$(CURRENT_LINK)\n"
+    "\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/debug all\n"
+"all_release: $(BUILD_DIR)/release/Makefile\n"
+    "\t@$(CURRENT_LINK)\n"
+    "\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/release all\n"
 "clean:\n"
-    "\t@$(MAKE) --no-print-directory -C build/debug clean\n"
-    "\t@$(MAKE) --no-print-directory -C build/release clean\n"
-"install:\n"
-    "\t@$(MAKE) --no-print-directory -C build/release install\n"
-"test:\n"
-    "\t@$(MAKE) --no-print-directory -C build/release test\n"
+    "\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/debug clean\n"
+    "\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/release clean\n"
+"install: $(BUILD_DIR)/release/Makefile\n"
+    "\t@$(MAKE) --no-print-directory -C $(BUILD_DIR)/release install\n"
+"test: all_release\n"
+    "\t@cd $(BUILD_DIR)/release && ctest -j$(TEST_JOBS)\n"
 "\n"
 "$(FORCE_BUILD_PROFILE):\n"
     "\techo $(FORCE_BUILD_PROFILE)\n"
     "\t$(file >.current_profile.mk,BUILD_PROFILE=$(BUILD_PROFILE))\n"
+    "\t@mkdir -p build && $(CURRENT_LINK)\n"
 "\n"
-"build/debug/Makefile:  $(BUILD_PROFILE) $(FORCE_BUILD_PROFILE) | build/debug/conf build/debug/log build/debug/data\n"
-    "\tmkdir -p build/debug/log\n"
+"$(BUILD_DIR)/debug/Makefile:  $(BUILD_PROFILE) | $(FORCE_BUILD_PROFILE) $(BUILD_DIR)/debug/conf $(BUILD_DIR)/debug/log $(BUILD_DIR)/debug/data\n"
+    "\tmkdir -p $(BUILD_DIR)/debug/log\n"
             //this is necesary as the cmake regenerates cache with default build type
-    "\trm -f build/debug/CMakeCache.txt\n"
-    "\tcmake -G \"Unix Makefiles\" -S . -B build/debug -DCMAKE_BUILD_TYPE=Debug `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)`\n"
+    "\trm -f $(BUILD_DIR)/debug/CMakeCache.txt\n"
+    "\tcmake -G \"Unix Makefiles\" -S . -B $(BUILD_DIR)/debug -DCMAKE_BUILD_TYPE=Debug `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)` -DBUILD_PROFILE_FILE=$(CURDIR)/$(BUILD_PROFILE)\n"
 "\n"
-"build/release/Makefile: $(BUILD_PROFILE) $(FORCE_BUILD_PROFILE) | build/release/conf build/release/log build/release/data\n"
-    "\tmkdir -p build/release/log\n"
+"$(BUILD_DIR)/release/Makefile: $(BUILD_PROFILE) | $(FORCE_BUILD_PROFILE) $(BUILD_DIR)/release/conf $(BUILD_DIR)/release/log $(BUILD_DIR)/release/data\n"
+    "\tmkdir -p $(BUILD_DIR)/release/log\n"
             //this is necesary as the cmake regenerates cache with default build type
-    "\trm -f build/release/CMakeCache.txt\n"
-    "\tcmake -G \"Unix Makefiles\" -S . -B build/release -DCMAKE_BUILD_TYPE=Release `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)`\n"
+    "\trm -f $(BUILD_DIR)/release/CMakeCache.txt\n"
+    "\tcmake -G \"Unix Makefiles\" -S . -B $(BUILD_DIR)/release -DCMAKE_BUILD_TYPE=Release `grep -E -v \"^[[:blank:]]*#\" $(BUILD_PROFILE)` -DBUILD_PROFILE_FILE=$(CURDIR)/$(BUILD_PROFILE)\n"
+"\n";
+    }
+    f << "cache-stats: " << (gen == Generator::ninja?"$(BUILD_DIR)/build.ninja":"$(BUILD_DIR)/release/Makefile") << "\n"
+      << build_command(gen, "Release", "cache-stats") << "\n";
+    //benchmarks are always measured on the release build
+    f << "bench: all_release\n"
+         "\t@test -d src/cxxbench || (echo \"The project has no benchmarks, add one by 'cxxproject add benchmark <name>'\"; exit 1)\n"
+      << build_command(gen, "Release", "bench") << "\n";
+    //compares benchmarks of HEAD with the last release tag, PERF_THRESHOLD is in percent
+    f <<
+"PERF_BASE ?=\n"
+"PERF_RUNS ?= 5\n"
+"PERF_THRESHOLD ?= 5\n"
+"PERF_ALPHA ?= 0.01\n"
+"PERF_ARGS ?=\n"
 "\n"
-"build/debug/conf: | build/debug conf \n"
-     "\tcd build/debug; ln -s ../../conf conf\n"
-
-"build/release/conf: | build/release conf \n"
-     "\tcd build/release; ln -s ../../conf conf\n"
+"perf-check: | $(FORCE_BUILD_PROFILE) conf data\n"
+    "\t@BUILD_DIR=$(BUILD_DIR) BUILD_PROFILE=$(BUILD_PROFILE) PERF_GENERATOR=" << (gen == Generator::ninja?"Ninja":"\"Unix Makefiles\"") <<
+        " PERF_BASE=\"$(PERF_BASE)\" PERF_RUNS=$(PERF_RUNS) PERF_THRESHOLD=$(PERF_THRESHOLD) PERF_ALPHA=$(PERF_ALPHA) PERF_ARGS=\"$(PERF_ARGS)\" "
+        "sh cmake/PerfCheck.sh\n"
+"\n";
+    //builds the project with and without unity build to detect clashes between merged sources
+    f << "unity-check: $(BUILD_DIR)/unity-check/none/CMakeCache.txt $(BUILD_DIR)/unity-check/all/CMakeCache.txt\n"
+      << aux_build_command(gen, "$(BUILD_DIR)/unity-check/none", "all")
+      << aux_build_command(gen, "$(BUILD_DIR)/unity-check/all", "all")
+      << "\n";
+    makefile_aux_tree(f, gen, "$(BUILD_DIR)/unity-check/none", "Debug", "-DUNITY_BUILD_MODE=none");
+    makefile_aux_tree(f, gen, "$(BUILD_DIR)/unity-check/all", "Debug", "-DUNITY_BUILD_MODE=all -DCMAKE_UNITY_BUILD_BATCH_SIZE=0");
+    f <<
+"PGO_TRAINING ?= conf/pgo-training.sh\n"
+"PGO_SOURCE_STAMP = $(shell git rev-parse HEAD:src 2>/dev/null)-$(shell git diff HEAD -- src | git hash-object --stdin)\n"
 "\n"
-"build/debug/data: | build/debug data \n"
-     "\tcd build/debug; ln -s ../../data data\n"
-
-"build/release/data: | build/release data \n"
-     "\tcd build/release; ln -s ../../data data\n"
+//instrument -> train -> merge -> optimized build
+"pgo: pgo-train\n"
+    "\t@$(MAKE) --no-print-directory pgo-use\n"
+"\n"
+"pgo-gen: $(BUILD_DIR)/pgo-gen/CMakeCache.txt | $(BUILD_DIR)/pgo-gen/conf $(BUILD_DIR)/pgo-gen/log $(BUILD_DIR)/pgo-gen/data\n"
+    << aux_build_command(gen, "$(BUILD_DIR)/pgo-gen", "all") <<
 "\n"
-"build/debug/log: | build/debug\n"
-     "\tmkdir build/debug/log\n"
+"pgo-train: pgo-gen\n"
+    "\t@test -x $(PGO_TRAINING) || (echo \"Training workload $(PGO_TRAINING) not found. Create executable script, which runs programs from bin/ on representative data. It is started in $(BUILD_DIR)/pgo-gen\"; exit 1)\n"
+    "\trm -rf $(BUILD_DIR)/pgo-data\n"
+    "\tcd $(BUILD_DIR)/pgo-gen && $(abspath $(PGO_TRAINING))\n"
+    << aux_build_command(gen, "$(BUILD_DIR)/pgo-gen", "pgo-merge") <<
+    "\t@echo \"$(PGO_SOURCE_STAMP)\" > $(BUILD_DIR)/pgo-data/source.stamp\n"
 "\n"
-"build/release/log: | build/release\n"
-     "\tmkdir build/release/log\n"
+"pgo-use: $(BUILD_DIR)/pgo-use/CMakeCache.txt | $(BUILD_DIR)/pgo-use/conf $(BUILD_DIR)/pgo-use/log $(BUILD_DIR)/pgo-use/data\n"
+    "\t@test \"`cat $(BUILD_DIR)/pgo-data/source.stamp 2>/dev/null`\" = \"$(PGO_SOURCE_STAMP)\" || test -n \"$(PGO_ALLOW_STALE)\" "
+        "|| (echo \"Profile data in $(BUILD_DIR)/pgo-data are missing or stale (sources changed after training). Run 'make pgo' or set PGO_ALLOW_STALE=1\"; exit 1)\n"
+            //objects don't depend on profile data, so they must be rebuilt after training
+    "\t@if [ $(BUILD_DIR)/pgo-data/source.stamp -nt $(BUILD_DIR)/pgo-use/profile.stamp ]; then " << aux_build(gen, "$(BUILD_DIR)/pgo-use", "clean") << "; fi\n"
+    << aux_build_command(gen, "$(BUILD_DIR)/pgo-use", "all") <<
+    "\t@cp $(BUILD_DIR)/pgo-data/source.stamp $(BUILD_DIR)/pgo-use/profile.stamp\n"
+"\n";
+    makefile_aux_tree(f, gen, "$(BUILD_DIR)/pgo-gen", "Release", "-DPGO_MODE=generate -DPGO_PROFILE_DIR=$(CURDIR)/$(BUILD_DIR)/pgo-data");
+    makefile_aux_tree(f, gen, "$(BUILD_DIR)/pgo-use", "Release", "-DPGO_MODE=use -DPGO_PROFILE_DIR=$(CURDIR)/$(BUILD_DIR)/pgo-data");
+    f <<
+"PERF ?= perf\n"
+"PERF_RECORD_FLAGS ?= -g\n"
 "\n"
-"build/debug:\n"
-    "\t@mkdir -p build/debug\n"
+//EXEC selects the executable, if the project has more than one, RUN contains its arguments
+"profile: $(BUILD_DIR)/profile/CMakeCache.txt | $(BUILD_DIR)/profile/conf $(BUILD_DIR)/profile/log $(BUILD_DIR)/profile/data\n"
+    << aux_build_command(gen, "$(BUILD_DIR)/profile", "all") <<
+    "\t@cd $(BUILD_DIR)/profile && exe=\"$(EXEC)\" && if [ -z \"$$exe\" ]; then exe=`ls bin`; fi && "
+        "if [ ! -f \"bin/$$exe\" ]; then echo \"Select executable by EXEC=<name>:\" `ls bin`; exit 1; fi && "
+        "echo \"$(PERF) record $(PERF_RECORD_FLAGS) bin/$$exe $(RUN)\" && "
+        "$(PERF) record $(PERF_RECORD_FLAGS) -o log/perf.data -- bin/$$exe $(RUN)\n"
+    "\t$(PERF) script -i $(BUILD_DIR)/profile/log/perf.data | awk -f cmake/PerfFold.awk > $(BUILD_DIR)/profile/log/perf.folded\n"
+    "\t@echo \"Flamegraph input: $(BUILD_DIR)/profile/log/perf.folded\"\n"
+"\n";
+    makefile_aux_tree(f, gen, "$(BUILD_DIR)/profile", "RelWithDebInfo", "");
+    //removes the executable and measures how long it takes to link it again
+    f <<
+"LINK_BENCH_RUNS ?= 5\n"
 "\n"
-"build/release:\n"
-    "\t@mkdir -p build/release\n"
-            "\n"
+"link-bench: all_debug\n"
+    "\t@exe=\"$(EXEC)\" && if [ -z \"$$exe\" ]; then exe=`ls $(BUILD_DIR)/debug/bin`; fi && "
+        "if [ ! -f \"$(BUILD_DIR)/debug/bin/$$exe\" ]; then echo \"Select executable by EXEC=<name>:\" `ls $(BUILD_DIR)/debug/bin`; exit 1; fi && "
+        "echo \"Relinking $$exe ($(LINK_BENCH_RUNS) runs)\" && "
+        "for i in `seq $(LINK_BENCH_RUNS)`; do "
+            "rm -f $(BUILD_DIR)/debug/bin/$$exe; s=`date +%s%N`; "
+            << (gen == Generator::ninja
+                ?"cmake --build $(BUILD_DIR) --config Debug --target $$exe"
+                :"$(MAKE) --no-print-directory -C $(BUILD_DIR)/debug $$exe/fast")
+            << " > /dev/null || exit 1; echo $$(( (`date +%s%N` - s) / 1000000 )); "
+        "done | awk '{print \"run \" NR \": \" $$1 \" ms\"; t += $$1; if (NR == 1 || $$1 < m) m = $$1} END {print \"min: \" m \" ms, avg: \" int(t / NR) \" ms\"}'\n"
+"\n";
+    makefile_build_dir_rules(f, "$(BUILD_DIR)/debug");
+    makefile_build_dir_rules(f, "$(BUILD_DIR)/release");
+    makefile_build_dir_rules(f, "$(BUILD_DIR)/pgo-gen");
+    makefile_build_dir_rules(f, "$(BUILD_DIR)/pgo-use");
+    makefile_build_dir_rules(f, "$(BUILD_DIR)/profile");
+    f <<
 "conf:\n"
     "\t@mkdir -p conf\n"
 "\n"
 "data:\n"
     "\t@mkdir -p data\n"
 "\n"
+//removes build trees of all profiles except the current one
+"profiles-clean:\n"
+    "\t@for d in build/*/; do n=`basename $$d`; "
+        "if [ \"$$n\" != \"$(PROFILE_NAME)\" ] && [ ! -L build/$$n ]; then echo \"rm -rf build/$$n\"; rm -rf build/$$n; fi; done\n"
+"\n"
 "distclean:\n"
     "\trm -rfv build\n";
 }
@@ -104,9 +378,624 @@ static void install_default_build_profile() {
          "##\n"
          "## Example: use compile 'clang++' \n"
          "# -DCMAKE_CXX_COMPILER=clang++\n"
+         "\n"
+         "## Compiler cache: auto (ccache or sccache), ccache, sccache, off\n"
+         "# -DCOMPILER_CACHE=off\n"
+         "## Directory of the compiler cache relative to the project root\n"
+         "## (default: the cache of the tool shared by all checkouts)\n"
+         "# -DCOMPILER_CACHE_DIR=../.ccache\n"
+         "\n"
+         "## Unity build: target (only targets created with --unity), all, none\n"
+         "# -DUNITY_BUILD_MODE=all\n"
+         "## Count of sources merged into one unity source (0 - all sources of a target)\n"
+         "# -DCMAKE_UNITY_BUILD_BATCH_SIZE=16\n"
+         "\n"
+         "## Linker of debug builds: auto (mold or lld), mold, lld, default\n"
+         "# -DLINKER=default\n"
+         "## Split debug info and gdb index of debug builds\n"
+         "# -DSPLIT_DWARF=OFF\n"
+         "# -DGDB_INDEX=OFF\n"
          "\n";
 }
 
+struct ProfileTemplate {
+    std::string_view name;
+    std::string_view content;
+    ///CMake module, which implements options of the profile
+    std::string_view module = "Optimization";
+};
+
+static const ProfileTemplate profile_templates[] = {
+    {"release-lto",
+        "## Release build with link time optimization\n"
+        "## (thin LTO with Clang, parallel LTO without fat objects with GCC)\n"
+        "-DLTO=ON\n"
+    },
+    {"release-native",
+        "## Release build tuned for the CPU of this machine\n"
+        "## Calls of shared libraries bypass PLT, the GOT is protected by full RELRO\n"
+        "-DRELEASE_COMPILE_OPTIONS=-march=native;-fno-semantic-interposition;-fno-plt\n"
+        "-DRELEASE_LINK_OPTIONS=-Wl,-z,relro;-Wl,-z,now\n"
+    },
+    {"release-portable",
+        "## Release build for fixed baseline x86-64-v3 (AVX2, BMI2, FMA)\n"
+        "-DRELEASE_COMPILE_OPTIONS=-march=x86-64-v3;-mtune=generic\n"
+    },
+    {"build-timing",
+        "## Collects compile time of each source for 'cxxproject build-report'\n"
+        "## The compiler cache is disabled, so all sources are compiled\n"
+        "-DBUILD_TIME_TRACE=ON\n"
+        "-DCOMPILER_CACHE=off\n",
+        "BuildTrace"
+    },
+    {"release-multi-isa",
+        "## Release build of executables for x86-64-v2, v3 and v4 into bin/<level>/ with a launcher in bin/,\n"
+        "## which executes the best variant supported by the CPU (make install installs all of them)\n"
+        "-DMULTI_ISA=x86-64-v2;x86-64-v3;x86-64-v4\n",
+        "MultiIsa"
+    },
+};
+
+static void install_profile(const ProfileTemplate &t) {
+    std::filesystem::create_directories(profiles);
+    std::ofstream f(profiles/(std::string(t.name)+".conf"), std::ios::out|std::ios::trunc);
+    f << t.content;
+}
+
+static void install_optimization_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"Optimization.cmake", std::ios::out|std::ios::trunc);
+    f << "# Optimization of release builds, configured by build profiles\n";
+    f << "set(LTO OFF CACHE BOOL \"Link time optimization of release builds\")\n";
+    f << "set(RELEASE_COMPILE_OPTIONS \"\" CACHE STRING \"Additional compile options of release builds (separated by ;)\")\n";
+    f << "set(RELEASE_LINK_OPTIONS \"\" CACHE STRING \"Additional link options of release builds (separated by ;)\")\n";
+    f << "\n";
+    f << "add_compile_options(\"$<$<CONFIG:Release>:${RELEASE_COMPILE_OPTIONS}>\")\n";
+    f << "add_link_options(\"$<$<CONFIG:Release>:${RELEASE_LINK_OPTIONS}>\")\n";
+    f << "if(LTO)\n";
+    f << "  # targets of directories requiring older CMake must honor INTERPROCEDURAL_OPTIMIZATION too\n";
+    f << "  cmake_policy(SET CMP0069 NEW)\n";
+    f << "  set(CMAKE_POLICY_DEFAULT_CMP0069 NEW)\n";
+    f << "  include(CheckIPOSupported)\n";
+    f << "  check_ipo_supported(RESULT LTO_SUPPORTED OUTPUT LTO_ERROR)\n";
+    f << "  if(LTO_SUPPORTED)\n";
+    f << "    # CMake selects -flto=thin for Clang and -flto=auto -fno-fat-lto-objects for GCC\n";
+    f << "    set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_RELEASE ON)\n";
+    f << "  else()\n";
+    f << "    message(WARNING \"Link time optimization is not supported: ${LTO_ERROR}\")\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+}
+
+static void install_profiling_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"Profiling.cmake", std::ios::out|std::ios::trunc);
+    f << "# Profiling build (RelWithDebInfo) with code generation friendly to sampling profilers\n";
+    f << "# Frame pointers are kept, so 'perf record -g' gets complete stacks without DWARF unwinding\n";
+    f << "if(CMAKE_CXX_COMPILER_ID MATCHES \"GNU|Clang\")\n";
+    f << "  include(CheckCXXCompilerFlag)\n";
+    f << "  set(PROFILING_COMPILE_OPTIONS -fno-omit-frame-pointer)\n";
+    f << "  check_cxx_compiler_flag(-mno-omit-leaf-frame-pointer HAVE_NO_OMIT_LEAF_FRAME_POINTER)\n";
+    f << "  if(HAVE_NO_OMIT_LEAF_FRAME_POINTER)\n";
+    f << "    list(APPEND PROFILING_COMPILE_OPTIONS -mno-omit-leaf-frame-pointer)\n";
+    f << "  endif()\n";
+    f << "  add_compile_options(\"$<$<CONFIG:RelWithDebInfo>:${PROFILING_COMPILE_OPTIONS}>\")\n";
+    f << "endif()\n";
+    f.close();
+
+    std::ofstream m(cmake_modules/"PerfFold.awk", std::ios::out|std::ios::trunc);
+    m << "# Folds stacks of 'perf script' output to the input of flamegraph.pl (invoked by make profile)\n";
+    m << "function flush(    s, i) {\n";
+    m << "    if (n) {\n";
+    m << "        s = comm\n";
+    m << "        for (i = n - 1; i >= 0; i--) s = s \";\" frame[i]\n";
+    m << "        count[s]++\n";
+    m << "    }\n";
+    m << "    n = 0\n";
+    m << "}\n";
+    m << "# header of a sample, the first word is the name of the command\n";
+    m << "/^[^ \\t]/ { flush(); comm = $1; next }\n";
+    m << "/^[ \\t]*$/ { flush(); next }\n";
+    m << "# frame: <address> <symbol>+<offset> (<dso>)\n";
+    m << "{\n";
+    m << "    sym = $0\n";
+    m << "    sub(/^[ \\t]*[0-9a-f]+ /, \"\", sym)\n";
+    m << "    sub(/ \\([^()]*\\)$/, \"\", sym)\n";
+    m << "    sub(/\\+0x[0-9a-f]+$/, \"\", sym)\n";
+    m << "    frame[n++] = sym\n";
+    m << "}\n";
+    m << "END { flush(); for (s in count) print s, count[s] }\n";
+}
+
+///Scripts of make perf-check
+static void install_perf_check_scripts() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"PerfCheck.sh", std::ios::out|std::ios::trunc);
+    f << "# Compares benchmarks of the last release tag (baseline) with HEAD (invoked by make perf-check)\n";
+    f << "# Both commits are built in worktrees in $BUILD_DIR/perf-check, results of the baseline are cached in data/perf-baseline\n";
+    f << "set -e\n";
+    f << "root=`pwd`\n";
+    f << "base=${PERF_BASE:-`git describe --tags --abbrev=0 2>/dev/null || true`}\n";
+    f << "if [ -z \"$base\" ]; then echo \"No release tag found, select the baseline by PERF_BASE=<commit>\"; exit 1; fi\n";
+    f << "base_commit=`git rev-parse --verify -q \"$base^{commit}\"` || { echo \"Unknown baseline: $base\"; exit 1; }\n";
+    f << "head_commit=`git rev-parse HEAD`\n";
+    f << "if [ \"$base_commit\" = \"$head_commit\" ]; then echo \"HEAD is the baseline $base, nothing to compare\"; exit 0; fi\n";
+    f << "git diff --quiet HEAD -- || echo \"Warning: uncommitted changes are not measured, only HEAD is built\"\n";
+    f << "args=`grep -E -v \"^[[:blank:]]*#\" \"$BUILD_PROFILE\" || true`\n";
+    f << "dir=$root/$BUILD_DIR/perf-check\n";
+    f << "# results depend on the machine, the compiler and the build profile\n";
+    f << "key=`{ echo \"$base_commit $PERF_RUNS $PERF_ARGS\"; uname -nm; cat \"$BUILD_PROFILE\"; ${CXX:-c++} --version 2>/dev/null || true; } | git hash-object --stdin | cut -c1-12`\n";
+    f << "cache=$root/data/perf-baseline/`echo \"$base\" | tr '/' '-'`-$key\n";
+    f << "\n";
+    f << "# build <name> <commit>\n";
+    f << "build() {\n";
+    f << "    src=$dir/$1\n";
+    f << "    git worktree prune\n";
+    f << "    if [ -e \"$src/.git\" ]; then\n";
+    f << "        git -C \"$src\" checkout -q --detach \"$2\"\n";
+    f << "    else\n";
+    f << "        mkdir -p \"$dir\"\n";
+    f << "        git worktree add -q --detach \"$src\" \"$2\"\n";
+    f << "    fi\n";
+    f << "    if [ -f \"$src/.gitmodules\" ]; then git -C \"$src\" submodule -q update --init --recursive; fi\n";
+    f << "    mkdir -p \"$src-build/log\"\n";
+    f << "    ln -sfn \"$root/conf\" \"$src-build/conf\"\n";
+    f << "    ln -sfn \"$root/data\" \"$src-build/data\"\n";
+    f << "    echo \"Building $1 ($2)\"\n";
+    f << "    # the tree is configured again from scratch when the build profile changes\n";
+    f << "    if [ \"`cat \"$src-build/profile.args\" 2>/dev/null`\" != \"$args\" ]; then rm -f \"$src-build/CMakeCache.txt\"; fi\n";
+    f << "    echo \"$args\" > \"$src-build/profile.args\"\n";
+    f << "    { [ -f \"$src-build/CMakeCache.txt\" ] || cmake -G \"$PERF_GENERATOR\" -S \"$src\" -B \"$src-build\" -DCMAKE_BUILD_TYPE=Release $args; } > \"$src-build/log/perf-check.log\" 2>&1 \\\n";
+    f << "        && cmake --build \"$src-build\" -j `nproc 2>/dev/null || echo 1` >> \"$src-build/log/perf-check.log\" 2>&1 \\\n";
+    f << "        || { tail -n 30 \"$src-build/log/perf-check.log\"; echo \"Build of $1 failed, see $src-build/log/perf-check.log\"; exit 1; }\n";
+    f << "}\n";
+    f << "\n";
+    f << "# run <name> <output directory> <run>\n";
+    f << "run() {\n";
+    f << "    mkdir -p \"$2\"\n";
+    f << "    for exe in \"$dir/$1-build\"/bench/*; do\n";
+    f << "        if [ ! -f \"$exe\" ] || [ ! -x \"$exe\" ]; then continue; fi\n";
+    f << "        name=`basename \"$exe\"`\n";
+    f << "        (cd \"$dir/$1-build\" && \"bench/$name\" --json \"$2/$name.$3.json\" $PERF_ARGS > /dev/null) || { echo \"Benchmark $name of $1 failed\"; exit 1; }\n";
+    f << "    done\n";
+    f << "}\n";
+    f << "\n";
+    f << "build head \"$head_commit\"\n";
+    f << "if [ -f \"$cache/complete\" ]; then\n";
+    f << "    echo \"Baseline $base: cached in ${cache#$root/}\"\n";
+    f << "else\n";
+    f << "    build base \"$base_commit\"\n";
+    f << "    rm -rf \"$cache.tmp\"\n";
+    f << "fi\n";
+    f << "rm -rf \"$dir/head-results\"\n";
+    f << "i=1\n";
+    f << "while [ $i -le $PERF_RUNS ]; do\n";
+    f << "    echo \"Run $i/$PERF_RUNS\"\n";
+    f << "    # runs of the baseline and HEAD alternate, so both see the same drift of the machine\n";
+    f << "    if [ ! -f \"$cache/complete\" ]; then run base \"$cache.tmp\" $i; fi\n";
+    f << "    run head \"$dir/head-results\" $i\n";
+    f << "    i=`expr $i + 1`\n";
+    f << "done\n";
+    f << "if [ ! -f \"$cache/complete\" ]; then\n";
+    f << "    touch \"$cache.tmp/complete\"\n";
+    f << "    rm -rf \"$cache\"\n";
+    f << "    mv \"$cache.tmp\" \"$cache\"\n";
+    f << "fi\n";
+    f << "echo\n";
+    f << "files=`ls \"$cache\"/*.json \"$dir/head-results\"/*.json 2>/dev/null || true`\n";
+    f << "if [ -z \"$files\" ]; then echo \"No benchmarks found (add them by 'cxxproject add benchmark <name>')\"; exit 0; fi\n";
+    f << "awk -v base=\"$cache/\" -v threshold=\"$PERF_THRESHOLD\" -v alpha=\"$PERF_ALPHA\" -f \"$root/cmake/PerfCompare.awk\" $files\n";
+    f.close();
+
+    std::ofstream m(cmake_modules/"PerfCompare.awk", std::ios::out|std::ios::trunc);
+    m << "# Compares results of benchmarks of the baseline (files in the directory base) with HEAD (invoked by make perf-check)\n";
+    m << "# Samples of all runs are pooled, a change of the median is significant if Mann-Whitney U test rejects equality at alpha\n";
+    m << "# and it is regression if the median is slower by more than threshold percent\n";
+    m << "function sort(v, l, n,    gap, i, j, t, u) {\n";
+    m << "    for (gap = int(n / 2); gap > 0; gap = int(gap / 2)) {\n";
+    m << "        for (i = gap + 1; i <= n; i++) {\n";
+    m << "            t = v[i]; u = l[i]\n";
+    m << "            for (j = i; j > gap && v[j - gap] > t; j -= gap) { v[j] = v[j - gap]; l[j] = l[j - gap] }\n";
+    m << "            v[j] = t; l[j] = u\n";
+    m << "        }\n";
+    m << "    }\n";
+    m << "}\n";
+    m << "function median(side, key,    n, i, v, l) {\n";
+    m << "    n = count[side, key]\n";
+    m << "    for (i = 1; i <= n; i++) { v[i] = value[side, key, i]; l[i] = 0 }\n";
+    m << "    sort(v, l, n)\n";
+    m << "    return n % 2 ? v[(n + 1) / 2] : (v[n / 2] + v[n / 2 + 1]) / 2\n";
+    m << "}\n";
+    m << "# two-sided p-value of Mann-Whitney U test (normal approximation, ties get average rank)\n";
+    m << "function mann_whitney(key,    n1, n2, n, i, j, k, v, l, r1, rank, u, sigma, z, t) {\n";
+    m << "    n1 = count[\"base\", key]; n2 = count[\"head\", key]\n";
+    m << "    for (i = 1; i <= n1; i++) { v[i] = value[\"base\", key, i]; l[i] = 1 }\n";
+    m << "    for (i = 1; i <= n2; i++) { v[n1 + i] = value[\"head\", key, i]; l[n1 + i] = 0 }\n";
+    m << "    n = n1 + n2\n";
+    m << "    sort(v, l, n)\n";
+    m << "    r1 = 0\n";
+    m << "    for (i = 1; i <= n; i = j) {\n";
+    m << "        for (j = i + 1; j <= n && v[j] == v[i]; j++);\n";
+    m << "        rank = (i + j - 1) / 2\n";
+    m << "        for (k = i; k < j; k++) if (l[k]) r1 += rank\n";
+    m << "    }\n";
+    m << "    u = r1 - n1 * (n1 + 1) / 2\n";
+    m << "    sigma = sqrt(n1 * n2 * (n + 1) / 12)\n";
+    m << "    if (sigma == 0) return 1\n";
+    m << "    z = (u - n1 * n2 / 2) / sigma\n";
+    m << "    if (z < 0) z = -z\n";
+    m << "    z = z / sqrt(2)\n";
+    m << "    # erfc (Abramowitz and Stegun 7.1.26)\n";
+    m << "    t = 1 / (1 + 0.3275911 * z)\n";
+    m << "    return t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429)))) * exp(-z * z)\n";
+    m << "}\n";
+    m << "function format_time(ns) {\n";
+    m << "    if (ns < 1e3) return sprintf(\"%.2f ns\", ns)\n";
+    m << "    if (ns < 1e6) return sprintf(\"%.2f us\", ns / 1e3)\n";
+    m << "    if (ns < 1e9) return sprintf(\"%.2f ms\", ns / 1e6)\n";
+    m << "    return sprintf(\"%.2f s\", ns / 1e9)\n";
+    m << "}\n";
+    m << "FNR == 1 { side = index(FILENAME, base) == 1 ? \"base\" : \"head\" }\n";
+    m << "/\"executable\":/ { exe = $0; sub(/.*\"executable\": \"/, \"\", exe); sub(/\".*/, \"\", exe) }\n";
+    m << "/\"name\":/ {\n";
+    m << "    name = $0; sub(/.*\"name\": \"/, \"\", name); sub(/\".*/, \"\", name)\n";
+    m << "    samples = $0; sub(/.*\"samples_ns\": \\[/, \"\", samples); sub(/\\].*/, \"\", samples)\n";
+    m << "    key = exe \"/\" name\n";
+    m << "    if (!(key in seen)) { seen[key] = 1; order[++keys] = key }\n";
+    m << "    n = split(samples, v, /, */)\n";
+    m << "    for (i = 1; i <= n; i++) value[side, key, ++count[side, key]] = v[i] + 0\n";
+    m << "}\n";
+    m << "END {\n";
+    m << "    printf \"%-40s %12s %12s %9s %9s  %s\\n\", \"Benchmark\", \"Baseline\", \"HEAD\", \"Change\", \"p-value\", \"Result\"\n";
+    m << "    failed = 0\n";
+    m << "    for (k = 1; k <= keys; k++) {\n";
+    m << "        key = order[k]\n";
+    m << "        if (!count[\"base\", key]) { printf \"%-40s %12s %12s %9s %9s  %s\\n\", key, \"-\", format_time(median(\"head\", key)), \"\", \"\", \"new\"; continue }\n";
+    m << "        if (!count[\"head\", key]) { printf \"%-40s %12s %12s %9s %9s  %s\\n\", key, format_time(median(\"base\", key)), \"-\", \"\", \"\", \"removed\"; continue }\n";
+    m << "        b = median(\"base\", key); h = median(\"head\", key)\n";
+    m << "        change = b > 0 ? (h - b) / b * 100 : 0\n";
+    m << "        p = mann_whitney(key)\n";
+    m << "        result = \"ok\"\n";
+    m << "        if (p < alpha && change > threshold) { result = \"REGRESSION\"; failed++ }\n";
+    m << "        else if (p < alpha && change < -threshold) result = \"improved\"\n";
+    m << "        else if (change > threshold || change < -threshold) result = \"noise\"\n";
+    m << "        printf \"%-40s %12s %12s %+8.1f%% %9.4f  %s\\n\", key, format_time(b), format_time(h), change, p, result\n";
+    m << "    }\n";
+    m << "    printf \"\\n(median of all samples, threshold %s%%, alpha %s)\\n\", threshold, alpha\n";
+    m << "    if (failed) { printf \"%d benchmark(s) regressed\\n\", failed; exit 1 }\n";
+    m << "}\n";
+}
+
+static void install_multi_isa_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"MultiIsa.cmake", std::ios::out|std::ios::trunc);
+    f << "# Release builds of executables for several x86-64 ISA levels with a launcher, which executes the best one\n";
+    f << "# The build profile enables it by -DMULTI_ISA=x86-64-v2;x86-64-v3;x86-64-v4 (see profile release-multi-isa)\n";
+    f << "# Each level is built by own single-configuration tree in multi-isa/<level> into bin/<level>/ of the release build,\n";
+    f << "# the baseline build of the executable is moved to bin/x86-64/ and the launcher takes its place in bin/\n";
+    f << "set(MULTI_ISA \"\" CACHE STRING \"x86-64 ISA levels of release builds of executables (separated by ;)\")\n";
+    f << "set(MULTI_ISA_ENABLED OFF)\n";
+    f << "if(MULTI_ISA)\n";
+    f << "  get_property(MULTI_ISA_MULTI_CONFIG GLOBAL PROPERTY GENERATOR_IS_MULTI_CONFIG)\n";
+    f << "  if(NOT CMAKE_SYSTEM_PROCESSOR MATCHES \"x86_64|AMD64|amd64\")\n";
+    f << "    message(WARNING \"MULTI_ISA is supported only on x86-64\")\n";
+    f << "  elseif(MULTI_ISA_MULTI_CONFIG OR CMAKE_BUILD_TYPE STREQUAL \"Release\")\n";
+    f << "    set(MULTI_ISA_ENABLED ON)\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+    f << "\n";
+    f << "if(MULTI_ISA_ENABLED)\n";
+    f << "  include(CheckCXXCompilerFlag)\n";
+    f << "  include(GNUInstallDirs)\n";
+    f << "  foreach(LEVEL ${MULTI_ISA})\n";
+    f << "    if(NOT LEVEL MATCHES \"^x86-64-v[234]$\")\n";
+    f << "      message(FATAL_ERROR \"Unknown ISA level ${LEVEL} (expected: x86-64-v2, x86-64-v3 or x86-64-v4)\")\n";
+    f << "    endif()\n";
+    f << "    string(REPLACE \"-\" \"_\" LEVEL_ID ${LEVEL})\n";
+    f << "    check_cxx_compiler_flag(-march=${LEVEL} HAVE_MARCH_${LEVEL_ID})\n";
+    f << "    if(NOT HAVE_MARCH_${LEVEL_ID})\n";
+    f << "      message(FATAL_ERROR \"The compiler doesn't support -march=${LEVEL}\")\n";
+    f << "    endif()\n";
+    f << "  endforeach()\n";
+    f << "  message(STATUS \"Multi-ISA release build: ${MULTI_ISA}\")\n";
+    f << "\n";
+    f << "  set(MULTI_ISA_DIR ${CMAKE_BINARY_DIR}/multi-isa)\n";
+    f << "  if(MULTI_ISA_MULTI_CONFIG)\n";
+    f << "    set(MULTI_ISA_OUTPUT_DIR ${CMAKE_BINARY_DIR}/release)\n";
+    f << "  else()\n";
+    f << "    set(MULTI_ISA_OUTPUT_DIR ${CMAKE_BINARY_DIR})\n";
+    f << "  endif()\n";
+    f << "  set(MULTI_ISA_LAUNCHER ${CMAKE_CURRENT_LIST_DIR}/IsaLauncher.c)\n";
+    f << "\n";
+    f << "  # build profile of each level is the current profile extended by -march of the level\n";
+    f << "  set(PROFILE \"\")\n";
+    f << "  if(EXISTS \"${BUILD_PROFILE_FILE}\")\n";
+    f << "    file(READ ${BUILD_PROFILE_FILE} PROFILE)\n";
+    f << "  endif()\n";
+    f << "  foreach(LEVEL ${MULTI_ISA})\n";
+    f << "    set(OPTIONS ${RELEASE_COMPILE_OPTIONS} -march=${LEVEL})\n";
+    f << "    set(CONTENT \"${PROFILE}\\n## ${LEVEL} variant of the multi-ISA build\\n-DMULTI_ISA=\\n-DRELEASE_COMPILE_OPTIONS=${OPTIONS}\\n\")\n";
+    f << "    set(OLD \"\")\n";
+    f << "    if(EXISTS ${MULTI_ISA_DIR}/${LEVEL}.conf)\n";
+    f << "      file(READ ${MULTI_ISA_DIR}/${LEVEL}.conf OLD)\n";
+    f << "    endif()\n";
+    f << "    # the tree of the level is configured again only when its profile changes\n";
+    f << "    if(NOT OLD STREQUAL CONTENT)\n";
+    f << "      file(WRITE ${MULTI_ISA_DIR}/${LEVEL}.conf \"${CONTENT}\")\n";
+    f << "    endif()\n";
+    f << "  endforeach()\n";
+    f << "\n";
+    f << "  cmake_host_system_information(RESULT MULTI_ISA_JOBS QUERY NUMBER_OF_LOGICAL_CORES)\n";
+    f << "  string(REPLACE \" Multi-Config\" \"\" MULTI_ISA_GENERATOR \"${CMAKE_GENERATOR}\")\n";
+    f << "  # levels are built one after another, each by all cores; executables are collected by multi_isa_executable()\n";
+    f << "  add_custom_target(multi_isa ALL\n";
+    f << "    COMMAND ${CMAKE_COMMAND} -DCONFIG=$<CONFIG> \"-DLEVELS=${MULTI_ISA}\" \"-DTARGETS=$<TARGET_PROPERTY:multi_isa,EXECUTABLES>\"\n";
+    f << "      -DSOURCE_DIR=${CMAKE_SOURCE_DIR} -DDIR=${MULTI_ISA_DIR} -DOUTPUT_DIR=${MULTI_ISA_OUTPUT_DIR}\n";
+    f << "      \"-DGENERATOR=${MULTI_ISA_GENERATOR}\" -DJOBS=${MULTI_ISA_JOBS}\n";
+    f << "      -DC_COMPILER=${CMAKE_C_COMPILER} -DCXX_COMPILER=${CMAKE_CXX_COMPILER}\n";
+    f << "      -P ${CMAKE_CURRENT_LIST_DIR}/MultiIsaBuild.cmake\n";
+    f << "    USES_TERMINAL VERBATIM)\n";
+    f << "endif()\n";
+    f << "\n";
+    f << "# Builds the executable for each level of MULTI_ISA and adds its launcher\n";
+    f << "function(multi_isa_executable TARGET)\n";
+    f << "  if(NOT MULTI_ISA_ENABLED)\n";
+    f << "    return()\n";
+    f << "  endif()\n";
+    f << "  set_property(TARGET multi_isa APPEND PROPERTY EXECUTABLES ${TARGET})\n";
+    f << "  get_target_property(DIR ${TARGET} RUNTIME_OUTPUT_DIRECTORY)\n";
+    f << "  if(NOT DIR)\n";
+    f << "    set(DIR ${CMAKE_CURRENT_BINARY_DIR})\n";
+    f << "  endif()\n";
+    f << "  string(REGEX REPLACE \"/+$\" \"\" DIR \"${DIR}\")\n";
+    f << "  set_target_properties(${TARGET} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${DIR}/x86-64)\n";
+    f << "\n";
+    f << "  add_executable(${TARGET}_launcher ${MULTI_ISA_LAUNCHER})\n";
+    f << "  set_target_properties(${TARGET}_launcher PROPERTIES OUTPUT_NAME ${TARGET} RUNTIME_OUTPUT_DIRECTORY ${DIR})\n";
+    f << "  target_compile_definitions(${TARGET}_launcher PRIVATE\n";
+    f << "    PROGRAM_NAME=\"${TARGET}\" INSTALL_DIR=\"../${CMAKE_INSTALL_LIBEXECDIR}/${TARGET}\")\n";
+    f << "  # the launcher must run on any x86-64 CPU\n";
+    f << "  target_compile_options(${TARGET}_launcher PRIVATE -march=x86-64)\n";
+    f << "\n";
+    f << "  install(TARGETS ${TARGET}_launcher RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR})\n";
+    f << "  install(TARGETS ${TARGET} RUNTIME DESTINATION ${CMAKE_INSTALL_LIBEXECDIR}/${TARGET}/x86-64)\n";
+    f << "  foreach(LEVEL ${MULTI_ISA})\n";
+    f << "    install(PROGRAMS ${MULTI_ISA_OUTPUT_DIR}/bin/${LEVEL}/${TARGET}\n";
+    f << "      DESTINATION ${CMAKE_INSTALL_LIBEXECDIR}/${TARGET}/${LEVEL} CONFIGURATIONS Release)\n";
+    f << "  endforeach()\n";
+    f << "endfunction()\n";
+    f.close();
+
+    std::ofstream b(cmake_modules/"MultiIsaBuild.cmake", std::ios::out|std::ios::trunc);
+    b << "# Builds executables of the project for each ISA level (target multi_isa of MultiIsa.cmake)\n";
+    b << "if(NOT CONFIG STREQUAL \"Release\" OR NOT TARGETS)\n";
+    b << "  return()\n";
+    b << "endif()\n";
+    b << "foreach(LEVEL ${LEVELS})\n";
+    b << "  set(TREE ${DIR}/${LEVEL})\n";
+    b << "  if(NOT EXISTS ${TREE}/CMakeCache.txt OR ${DIR}/${LEVEL}.conf IS_NEWER_THAN ${TREE}/CMakeCache.txt)\n";
+    b << "    message(STATUS \"Configuring ${LEVEL} build in ${TREE}\")\n";
+    b << "    file(REMOVE ${TREE}/CMakeCache.txt)\n";
+    b << "    # arguments of the profile are expanded by the shell like in the Makefile\n";
+    b << "    execute_process(COMMAND sh -c \"\\\"${CMAKE_COMMAND}\\\" -G \\\"${GENERATOR}\\\" -S \\\"${SOURCE_DIR}\\\" -B \\\"${TREE}\\\" -DCMAKE_BUILD_TYPE=Release -DCMAKE_C_COMPILER=\\\"${C_COMPILER}\\\" -DCMAKE_CXX_COMPILER=\\\"${CXX_COMPILER}\\\" -DBUILD_PROFILE_FILE=\\\"${DIR}/${LEVEL}.conf\\\" `grep -E -v \\\"^[[:blank:]]*#\\\" \\\"${DIR}/${LEVEL}.conf\\\"`\"\n";
+    b << "      RESULT_VARIABLE RESULT OUTPUT_VARIABLE OUTPUT ERROR_VARIABLE OUTPUT)\n";
+    b << "    if(NOT RESULT EQUAL 0)\n";
+    b << "      file(REMOVE ${TREE}/CMakeCache.txt)\n";
+    b << "      message(FATAL_ERROR \"Configuration of ${LEVEL} build failed:\\n${OUTPUT}\")\n";
+    b << "    endif()\n";
+    b << "  endif()\n";
+    b << "  message(STATUS \"Building ${LEVEL}: ${TARGETS}\")\n";
+    b << "  execute_process(COMMAND ${CMAKE_COMMAND} --build ${TREE} --parallel ${JOBS} --target ${TARGETS} RESULT_VARIABLE RESULT)\n";
+    b << "  if(NOT RESULT EQUAL 0)\n";
+    b << "    message(FATAL_ERROR \"Build of ${LEVEL} failed\")\n";
+    b << "  endif()\n";
+    b << "  file(MAKE_DIRECTORY ${OUTPUT_DIR}/bin/${LEVEL})\n";
+    b << "  foreach(TARGET ${TARGETS})\n";
+    b << "    execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${TREE}/bin/${TARGET} ${OUTPUT_DIR}/bin/${LEVEL}/${TARGET})\n";
+    b << "  endforeach()\n";
+    b << "endforeach()\n";
+    b.close();
+
+    std::ofstream l(cmake_modules/"IsaLauncher.c", std::ios::out|std::ios::trunc);
+    l << "/* Launcher of the multi-ISA build (see MultiIsa.cmake)\n";
+    l << " * Executes the variant of the program for the highest x86-64 ISA level supported by the CPU and the OS.\n";
+    l << " * Variants are searched in <dir>/<level>/ (build tree) and in <dir>/INSTALL_DIR/<level>/ (installed),\n";
+    l << " * where <dir> is the directory of the launcher. CXXPROJECT_ISA=<level> selects lower level. */\n";
+    l << "#include <cpuid.h>\n";
+    l << "#include <errno.h>\n";
+    l << "#include <limits.h>\n";
+    l << "#include <stdio.h>\n";
+    l << "#include <stdlib.h>\n";
+    l << "#include <string.h>\n";
+    l << "#include <unistd.h>\n";
+    l << "\n";
+    l << "#define ALL(reg, mask) (((reg) & (mask)) == (mask))\n";
+    l << "\n";
+    l << "static unsigned long long xgetbv0(void) {\n";
+    l << "    unsigned int eax, edx;\n";
+    l << "    __asm__ volatile(\"xgetbv\" : \"=a\"(eax), \"=d\"(edx) : \"c\"(0));\n";
+    l << "    return ((unsigned long long)edx << 32) | eax;\n";
+    l << "}\n";
+    l << "\n";
+    l << "/* highest level (1 - baseline x86-64 .. 4 - x86-64-v4) */\n";
+    l << "static int isa_level(void) {\n";
+    l << "    unsigned int a, b, c, d, c1, ext_c = 0, b7 = 0;\n";
+    l << "    unsigned long long xcr0 = 0;\n";
+    l << "    if (!__get_cpuid(1, &a, &b, &c, &d)) return 1;\n";
+    l << "    c1 = c;\n";
+    l << "    if (__get_cpuid(0x80000001, &a, &b, &c, &d)) ext_c = c;\n";
+    l << "    if (__get_cpuid_max(0, 0) >= 7) {\n";
+    l << "        __cpuid_count(7, 0, a, b, c, d);\n";
+    l << "        b7 = b;\n";
+    l << "    }\n";
+    l << "    /* SSE3, SSSE3, CMPXCHG16B, SSE4.1, SSE4.2, POPCNT, LAHF */\n";
+    l << "    if (!ALL(c1, (1u << 0) | (1u << 9) | (1u << 13) | (1u << 19) | (1u << 20) | (1u << 23)) || !ALL(ext_c, 1u << 0)) return 1;\n";
+    l << "    /* FMA, MOVBE, OSXSAVE, AVX, F16C, BMI1, AVX2, BMI2, LZCNT and the OS saves YMM registers */\n";
+    l << "    if (!ALL(c1, (1u << 12) | (1u << 22) | (1u << 27) | (1u << 28) | (1u << 29))\n";
+    l << "        || !ALL(b7, (1u << 3) | (1u << 5) | (1u << 8)) || !ALL(ext_c, 1u << 5)) return 2;\n";
+    l << "    xcr0 = xgetbv0();\n";
+    l << "    if (!ALL(xcr0, 0x6)) return 2;\n";
+    l << "    /* AVX512F, AVX512DQ, AVX512CD, AVX512BW, AVX512VL and the OS saves ZMM registers */\n";
+    l << "    if (!ALL(b7, (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31)) || !ALL(xcr0, 0xe6)) return 3;\n";
+    l << "    return 4;\n";
+    l << "}\n";
+    l << "\n";
+    l << "int main(int argc, char **argv) {\n";
+    l << "    static const char *const dirs[] = {\"\", INSTALL_DIR \"/\"};\n";
+    l << "    char self[PATH_MAX];\n";
+    l << "    char path[PATH_MAX + 64];\n";
+    l << "    ssize_t len = readlink(\"/proc/self/exe\", self, sizeof(self) - 1);\n";
+    l << "    char *slash;\n";
+    l << "    const char *forced = getenv(\"CXXPROJECT_ISA\");\n";
+    l << "    int level = isa_level();\n";
+    l << "    int l;\n";
+    l << "    unsigned int i;\n";
+    l << "    (void)argc;\n";
+    l << "    if (len <= 0) {\n";
+    l << "        perror(PROGRAM_NAME \": /proc/self/exe\");\n";
+    l << "        return 127;\n";
+    l << "    }\n";
+    l << "    self[len] = 0;\n";
+    l << "    slash = strrchr(self, '/');\n";
+    l << "    slash[1] = 0;\n";
+    l << "    if (forced && *forced) {\n";
+    l << "        int f = strcmp(forced, \"x86-64\") == 0 ? 1 : strncmp(forced, \"x86-64-v\", 8) == 0 ? atoi(forced + 8) : 0;\n";
+    l << "        if (f < 1 || f > 4) {\n";
+    l << "            fprintf(stderr, PROGRAM_NAME \": invalid CXXPROJECT_ISA=%s (expected: x86-64, x86-64-v2, x86-64-v3 or x86-64-v4)\\n\", forced);\n";
+    l << "            return 127;\n";
+    l << "        }\n";
+    l << "        if (f < level) level = f;\n";
+    l << "    }\n";
+    l << "    for (l = level; l >= 1; l--) {\n";
+    l << "        for (i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {\n";
+    l << "            if (l == 1) snprintf(path, sizeof(path), \"%s%sx86-64/\" PROGRAM_NAME, self, dirs[i]);\n";
+    l << "            else snprintf(path, sizeof(path), \"%s%sx86-64-v%d/\" PROGRAM_NAME, self, dirs[i], l);\n";
+    l << "            execv(path, argv);\n";
+    l << "            if (errno != ENOENT && errno != ENOTDIR) {\n";
+    l << "                perror(path);\n";
+    l << "                return 127;\n";
+    l << "            }\n";
+    l << "        }\n";
+    l << "    }\n";
+    l << "    fprintf(stderr, PROGRAM_NAME \": no variant of the program found in %s\\n\", self);\n";
+    l << "    return 127;\n";
+    l << "}\n";
+}
+
+static void install_fast_link_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"FastLink.cmake", std::ios::out|std::ios::trunc);
+    f << "# Fast linking of debug builds\n";
+    f << "#   LINKER      auto (mold, then lld), default (the linker of the compiler) or name for -fuse-ld\n";
+    f << "#   SPLIT_DWARF debug info is kept in .dwo files and is not processed by the linker\n";
+    f << "#   GDB_INDEX   the linker generates index of debug info for gdb\n";
+    f << "set(LINKER \"auto\" CACHE STRING \"Linker of debug builds: auto, mold, lld, default\")\n";
+    f << "set(SPLIT_DWARF ON CACHE BOOL \"Split debug info of debug builds (-gsplit-dwarf)\")\n";
+    f << "set(GDB_INDEX ON CACHE BOOL \"Generate gdb index in debug builds (--gdb-index)\")\n";
+    f << "\n";
+    f << "if(CMAKE_CXX_COMPILER_ID MATCHES \"GNU|Clang\")\n";
+    f << "  include(CheckCXXCompilerFlag)\n";
+    f << "  include(CheckCXXSourceCompiles)\n";
+    f << "  set(FAST_LINK_OPTIONS)\n";
+    f << "  set(FAST_LINKER_ID default)\n";
+    f << "  if(LINKER STREQUAL \"auto\")\n";
+    f << "    set(FAST_LINK_CANDIDATES mold lld)\n";
+    f << "  elseif(NOT LINKER STREQUAL \"default\")\n";
+    f << "    set(FAST_LINK_CANDIDATES ${LINKER})\n";
+    f << "  endif()\n";
+    f << "  foreach(FAST_LINKER_NAME ${FAST_LINK_CANDIDATES})\n";
+    f << "    set(CMAKE_REQUIRED_LINK_OPTIONS -fuse-ld=${FAST_LINKER_NAME})\n";
+    f << "    check_cxx_source_compiles(\"int main() {return 0;}\" HAVE_LINKER_${FAST_LINKER_NAME})\n";
+    f << "    unset(CMAKE_REQUIRED_LINK_OPTIONS)\n";
+    f << "    if(HAVE_LINKER_${FAST_LINKER_NAME})\n";
+    f << "      set(FAST_LINKER ${FAST_LINKER_NAME})\n";
+    f << "      set(FAST_LINKER_ID ${FAST_LINKER_NAME})\n";
+    f << "      list(APPEND FAST_LINK_OPTIONS -fuse-ld=${FAST_LINKER})\n";
+    f << "      break()\n";
+    f << "    endif()\n";
+    f << "  endforeach()\n";
+    f << "  if(FAST_LINKER)\n";
+    f << "    message(STATUS \"Linker of debug builds: ${FAST_LINKER}\")\n";
+    f << "  elseif(NOT LINKER STREQUAL \"auto\" AND NOT LINKER STREQUAL \"default\")\n";
+    f << "    message(FATAL_ERROR \"Linker ${LINKER} is not supported by the compiler\")\n";
+    f << "  endif()\n";
+    f << "\n";
+    f << "  if(SPLIT_DWARF)\n";
+    f << "    check_cxx_compiler_flag(-gsplit-dwarf HAVE_SPLIT_DWARF)\n";
+    f << "    if(HAVE_SPLIT_DWARF)\n";
+    f << "      add_compile_options($<$<CONFIG:Debug>:-gsplit-dwarf>)\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "  if(GDB_INDEX)\n";
+    f << "    # the default linker (ld.bfd) doesn't support --gdb-index\n";
+    f << "    set(CMAKE_REQUIRED_LINK_OPTIONS ${FAST_LINK_OPTIONS} -Wl,--gdb-index)\n";
+    f << "    check_cxx_source_compiles(\"int main() {return 0;}\" HAVE_GDB_INDEX_${FAST_LINKER_ID})\n";
+    f << "    unset(CMAKE_REQUIRED_LINK_OPTIONS)\n";
+    f << "    check_cxx_compiler_flag(-ggnu-pubnames HAVE_GNU_PUBNAMES)\n";
+    f << "    if(HAVE_GDB_INDEX_${FAST_LINKER_ID} AND HAVE_GNU_PUBNAMES)\n";
+    f << "      add_compile_options($<$<CONFIG:Debug>:-ggnu-pubnames>)\n";
+    f << "      list(APPEND FAST_LINK_OPTIONS -Wl,--gdb-index)\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "  add_link_options(\"$<$<CONFIG:Debug>:${FAST_LINK_OPTIONS}>\")\n";
+    f << "endif()\n";
+}
+
+static void install_cxx_modules_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"CxxModules.cmake", std::ios::out|std::ios::trunc);
+    f << "# C++20 modules of libraries created with --modules\n";
+    f << "# Dependencies between modules are scanned during the build, which needs CMake 3.28 and Ninja 1.11\n";
+    f << "if(CMAKE_VERSION VERSION_LESS 3.28)\n";
+    f << "  message(FATAL_ERROR \"C++ modules require CMake 3.28 or newer (found ${CMAKE_VERSION})\")\n";
+    f << "endif()\n";
+    f << "if(NOT CMAKE_GENERATOR MATCHES \"Ninja\")\n";
+    f << "  message(FATAL_ERROR \"C++ modules require the Ninja generator, use 'cxxproject update makefile --generator ninja'\")\n";
+    f << "endif()\n";
+    f << "execute_process(COMMAND ${CMAKE_MAKE_PROGRAM} --version OUTPUT_VARIABLE CXX_MODULES_NINJA_VERSION OUTPUT_STRIP_TRAILING_WHITESPACE)\n";
+    f << "if(CXX_MODULES_NINJA_VERSION VERSION_LESS 1.11)\n";
+    f << "  message(FATAL_ERROR \"C++ modules require Ninja 1.11 or newer (found ${CXX_MODULES_NINJA_VERSION})\")\n";
+    f << "endif()\n";
+    f << "# sources importing the modules are scanned as well, regardless of cmake_minimum_required of their directory\n";
+    f << "set(CMAKE_CXX_SCAN_FOR_MODULES ON)\n";
+}
+
+static void install_build_trace_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"BuildTrace.cmake", std::ios::out|std::ios::trunc);
+    f << "# Compile time of each source for 'cxxproject build-report'\n";
+    f << "#   Clang - time trace is written to <object>.json (-ftime-trace)\n";
+    f << "#   GCC   - report of the compiler is written to <object>.time-report (-ftime-report)\n";
+    f << "set(BUILD_TIME_TRACE OFF CACHE BOOL \"Collect compile time of each source\")\n";
+    f << "if(BUILD_TIME_TRACE)\n";
+    f << "  if(CMAKE_CXX_COMPILER_ID MATCHES \"Clang\")\n";
+    f << "    add_compile_options(-ftime-trace)\n";
+    f << "  elseif(CMAKE_CXX_COMPILER_ID STREQUAL \"GNU\")\n";
+    f << "    add_compile_options(-ftime-report)\n";
+    f << "    set(CMAKE_C_COMPILER_LAUNCHER sh ${CMAKE_CURRENT_LIST_DIR}/TimeReport.sh)\n";
+    f << "    set(CMAKE_CXX_COMPILER_LAUNCHER sh ${CMAKE_CURRENT_LIST_DIR}/TimeReport.sh)\n";
+    f << "  else()\n";
+    f << "    message(WARNING \"Compile time is not collected for ${CMAKE_CXX_COMPILER_ID}\")\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+    f.close();
+
+    std::ofstream m(cmake_modules/"TimeReport.sh", std::ios::out|std::ios::trunc);
+    m << "# Compiler launcher, which stores -ftime-report of GCC to <object>.time-report\n";
+    m << "out=\n";
+    m << "prev=\n";
+    m << "for a in \"$@\"; do\n";
+    m << "    if [ \"$prev\" = \"-o\" ]; then out=\"$a\"; fi\n";
+    m << "    prev=\"$a\"\n";
+    m << "done\n";
+    m << "if [ -z \"$out\" ]; then exec \"$@\"; fi\n";
+    m << "\"$@\" 2> \"$out.time-report\"\n";
+    m << "r=$?\n";
+    m << "# diagnostics of the compiler precede the report\n";
+    m << "sed -e '/^Time variable/,$d' -e '/^$/d' \"$out.time-report\" >&2\n";
+    m << "exit $r\n";
+}
+
 static void install_gitignore() {
     std::ofstream f(".gitignore", std::ios::out|std::ios::trunc);
     f << "/build" << std::endl;
@@ -114,19 +1003,488 @@ static void install_gitignore() {
 
 }
 
+static void install_compiler_cache_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"CompilerCache.cmake", std::ios::out|std::ios::trunc);
+    f << "# Compiler cache (ccache or sccache) shared by all build configurations\n";
+    f << "set(COMPILER_CACHE \"auto\" CACHE STRING \"Compiler cache: auto, ccache, sccache, off\")\n";
+    f << "set(COMPILER_CACHE_DIR \"\" CACHE STRING \"Directory of the compiler cache relative to the project root\")\n";
+    f << "\n";
+    f << "if(COMPILER_CACHE STREQUAL \"auto\")\n";
+    f << "  find_program(COMPILER_CACHE_PROGRAM NAMES ccache sccache)\n";
+    f << "elseif(NOT COMPILER_CACHE STREQUAL \"off\")\n";
+    f << "  find_program(COMPILER_CACHE_PROGRAM NAMES ${COMPILER_CACHE})\n";
+    f << "  if(NOT COMPILER_CACHE_PROGRAM)\n";
+    f << "    message(FATAL_ERROR \"Compiler cache ${COMPILER_CACHE} not found\")\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+    f << "\n";
+    f << "if(COMPILER_CACHE_PROGRAM AND NOT COMPILER_CACHE STREQUAL \"off\")\n";
+    f << "  get_filename_component(COMPILER_CACHE_NAME ${COMPILER_CACHE_PROGRAM} NAME_WE)\n";
+    f << "  set(COMPILER_CACHE_ENV)\n";
+    f << "  if(COMPILER_CACHE_DIR)\n";
+    f << "    get_filename_component(COMPILER_CACHE_ABS_DIR ${COMPILER_CACHE_DIR} ABSOLUTE BASE_DIR ${CMAKE_SOURCE_DIR})\n";
+    f << "  endif()\n";
+    f << "  if(COMPILER_CACHE_NAME STREQUAL \"sccache\")\n";
+    f << "    if(COMPILER_CACHE_ABS_DIR)\n";
+    f << "      list(APPEND COMPILER_CACHE_ENV SCCACHE_DIR=${COMPILER_CACHE_ABS_DIR})\n";
+    f << "    endif()\n";
+    f << "  else()\n";
+    f << "    # Paths are hashed relative to the project root and the working directory is not hashed,\n";
+    f << "    # so the same sources hit the cache from any checkout, worktree and configuration\n";
+    f << "    list(APPEND COMPILER_CACHE_ENV CCACHE_BASEDIR=${CMAKE_SOURCE_DIR} CCACHE_NOHASHDIR=true)\n";
+    f << "    if(COMPILER_CACHE_ABS_DIR)\n";
+    f << "      list(APPEND COMPILER_CACHE_ENV CCACHE_DIR=${COMPILER_CACHE_ABS_DIR})\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "  set(CMAKE_C_COMPILER_LAUNCHER ${CMAKE_COMMAND} -E env ${COMPILER_CACHE_ENV} ${COMPILER_CACHE_PROGRAM})\n";
+    f << "  set(CMAKE_CXX_COMPILER_LAUNCHER ${CMAKE_COMMAND} -E env ${COMPILER_CACHE_ENV} ${COMPILER_CACHE_PROGRAM})\n";
+    f << "  message(STATUS \"Compiler cache: ${COMPILER_CACHE_PROGRAM}\")\n";
+    f << "  add_custom_target(cache-stats COMMAND ${CMAKE_COMMAND} -E env ${COMPILER_CACHE_ENV} ${COMPILER_CACHE_PROGRAM} --show-stats)\n";
+    f << "else()\n";
+    f << "  add_custom_target(cache-stats COMMAND ${CMAKE_COMMAND} -E echo \"Compiler cache is not enabled\")\n";
+    f << "endif()\n";
+}
+
+static void install_unity_build_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"UnityBuild.cmake", std::ios::out|std::ios::trunc);
+    f << "# Unity (jumbo) build\n";
+    f << "#   target - only targets marked by target_unity_build() (default)\n";
+    f << "#   all    - all targets of the project\n";
+    f << "#   none   - unity build is disabled\n";
+    f << "# Size of batches is set by CMAKE_UNITY_BUILD_BATCH_SIZE (0 - all sources of a target in one batch)\n";
+    f << "set(UNITY_BUILD_MODE \"target\" CACHE STRING \"Unity build: target, all, none\")\n";
+    f << "if(UNITY_BUILD_MODE STREQUAL \"all\")\n";
+    f << "  set(CMAKE_UNITY_BUILD ON)\n";
+    f << "elseif(UNITY_BUILD_MODE STREQUAL \"none\")\n";
+    f << "  set(CMAKE_UNITY_BUILD OFF)\n";
+    f << "endif()\n";
+    f << "\n";
+    f << "# target_unity_build(<target> [EXCLUDE <sources>...])\n";
+    f << "# Builds the target as unity build. Sources listed after EXCLUDE are compiled separately\n";
+    f << "function(target_unity_build target)\n";
+    f << "  cmake_parse_arguments(UNITY \"\" \"\" \"EXCLUDE\" ${ARGN})\n";
+    f << "  if(NOT UNITY_BUILD_MODE STREQUAL \"none\")\n";
+    f << "    set_target_properties(${target} PROPERTIES UNITY_BUILD ON)\n";
+    f << "  endif()\n";
+    f << "  if(UNITY_EXCLUDE)\n";
+    f << "    set_source_files_properties(${UNITY_EXCLUDE} PROPERTIES SKIP_UNITY_BUILD_INCLUSION ON)\n";
+    f << "  endif()\n";
+    f << "endfunction()\n";
+}
+
+static void install_pgo_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"PGO.cmake", std::ios::out|std::ios::trunc);
+    f << "# Profile guided optimization\n";
+    f << "#   PGO_MODE=generate  instrumented build, profiles are collected to PGO_PROFILE_DIR\n";
+    f << "#   PGO_MODE=use       optimized build using the profiles collected in PGO_PROFILE_DIR\n";
+    f << "set(PGO_MODE \"\" CACHE STRING \"Profile guided optimization: generate, use or empty\")\n";
+    f << "set(PGO_PROFILE_DIR \"${CMAKE_SOURCE_DIR}/build/pgo-data\" CACHE PATH \"Directory of collected profiles\")\n";
+    f << "\n";
+    f << "if(PGO_MODE)\n";
+    f << "  set(PGO_COMPILER \"${CMAKE_CXX_COMPILER_ID}-${CMAKE_CXX_COMPILER_VERSION}\")\n";
+    f << "  if(PGO_MODE STREQUAL \"use\")\n";
+    f << "    if(NOT EXISTS ${PGO_PROFILE_DIR}/compiler.stamp)\n";
+    f << "      message(FATAL_ERROR \"No profile data in ${PGO_PROFILE_DIR}, run 'make pgo' to collect them\")\n";
+    f << "    endif()\n";
+    f << "    file(READ ${PGO_PROFILE_DIR}/compiler.stamp PGO_PROFILE_COMPILER)\n";
+    f << "    if(NOT PGO_PROFILE_COMPILER STREQUAL PGO_COMPILER)\n";
+    f << "      message(FATAL_ERROR \"Profile data were collected by ${PGO_PROFILE_COMPILER}, but the project is compiled by ${PGO_COMPILER}. Run 'make pgo' to collect them again\")\n";
+    f << "    endif()\n";
+    f << "  elseif(NOT PGO_MODE STREQUAL \"generate\")\n";
+    f << "    message(FATAL_ERROR \"Unknown PGO_MODE: ${PGO_MODE} (expected: generate, use)\")\n";
+    f << "  endif()\n";
+    f << "\n";
+    f << "  if(CMAKE_CXX_COMPILER_ID STREQUAL \"GNU\")\n";
+    f << "    if(CMAKE_CXX_COMPILER_VERSION VERSION_LESS 11)\n";
+    f << "      message(FATAL_ERROR \"Profile guided optimization requires GCC 11 or later\")\n";
+    f << "    endif()\n";
+    f << "    # .gcda files are named by paths of objects relative to the build directory,\n";
+    f << "    # so profiles collected by pgo-gen tree are found by pgo-use tree\n";
+    f << "    set(PGO_COMPILE_OPTIONS -fprofile-prefix-path=${CMAKE_BINARY_DIR})\n";
+    f << "    if(PGO_MODE STREQUAL \"generate\")\n";
+    f << "      list(APPEND PGO_COMPILE_OPTIONS -fprofile-generate=${PGO_PROFILE_DIR}/raw -fprofile-update=prefer-atomic)\n";
+    f << "      set(PGO_LINK_OPTIONS -fprofile-generate=${PGO_PROFILE_DIR}/raw)\n";
+    f << "    else()\n";
+    f << "      # changed functions are reported as error (coverage-mismatch)\n";
+    f << "      list(APPEND PGO_COMPILE_OPTIONS -fprofile-use=${PGO_PROFILE_DIR}/raw -fprofile-partial-training -Werror=coverage-mismatch)\n";
+    f << "    endif()\n";
+    f << "  elseif(CMAKE_CXX_COMPILER_ID MATCHES \"Clang\")\n";
+    f << "    if(PGO_MODE STREQUAL \"generate\")\n";
+    f << "      set(PGO_COMPILE_OPTIONS -fprofile-generate=${PGO_PROFILE_DIR}/raw)\n";
+    f << "      set(PGO_LINK_OPTIONS -fprofile-generate=${PGO_PROFILE_DIR}/raw)\n";
+    f << "      get_filename_component(PGO_COMPILER_DIR ${CMAKE_CXX_COMPILER} DIRECTORY)\n";
+    f << "      string(REGEX MATCH \"^[0-9]+\" PGO_COMPILER_MAJOR ${CMAKE_CXX_COMPILER_VERSION})\n";
+    f << "      find_program(LLVM_PROFDATA NAMES llvm-profdata-${PGO_COMPILER_MAJOR} llvm-profdata HINTS ${PGO_COMPILER_DIR})\n";
+    f << "      if(NOT LLVM_PROFDATA)\n";
+    f << "        message(FATAL_ERROR \"llvm-profdata not found, it is required to merge profiles\")\n";
+    f << "      endif()\n";
+    f << "    else()\n";
+    f << "      # changed functions are reported as error, sources not executed by the training\n";
+    f << "      # (tests, tools) only as warning like -Wmissing-profile of GCC\n";
+    f << "      set(PGO_COMPILE_OPTIONS -fprofile-use=${PGO_PROFILE_DIR}/merged.profdata\n";
+    f << "          -Werror=profile-instr-out-of-date -Wprofile-instr-unprofiled -Wno-error=profile-instr-unprofiled)\n";
+    f << "    endif()\n";
+    f << "  else()\n";
+    f << "    message(FATAL_ERROR \"Profile guided optimization is not supported for ${CMAKE_CXX_COMPILER_ID}\")\n";
+    f << "  endif()\n";
+    f << "  add_compile_options(${PGO_COMPILE_OPTIONS})\n";
+    f << "  add_link_options(${PGO_LINK_OPTIONS})\n";
+    f << "\n";
+    f << "  if(PGO_MODE STREQUAL \"generate\")\n";
+    f << "    add_custom_target(pgo-merge\n";
+    f << "      ${CMAKE_COMMAND} -D PGO_PROFILE_DIR=${PGO_PROFILE_DIR}\n";
+    f << "                       -D PGO_COMPILER=${PGO_COMPILER}\n";
+    f << "                       -D LLVM_PROFDATA=${LLVM_PROFDATA}\n";
+    f << "                       -P ${CMAKE_CURRENT_LIST_DIR}/PGOMerge.cmake\n";
+    f << "      )\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+    f.close();
+
+    std::ofstream m(cmake_modules/"PGOMerge.cmake", std::ios::out|std::ios::trunc);
+    m << "# Merges profiles collected by the training run (invoked by the target pgo-merge)\n";
+    m << "if(LLVM_PROFDATA)\n";
+    m << "  file(GLOB PGO_PROFILES ${PGO_PROFILE_DIR}/raw/*.profraw)\n";
+    m << "else()\n";
+    m << "  file(GLOB_RECURSE PGO_PROFILES ${PGO_PROFILE_DIR}/raw/*.gcda)\n";
+    m << "endif()\n";
+    m << "if(NOT PGO_PROFILES)\n";
+    m << "  message(FATAL_ERROR \"No profiles in ${PGO_PROFILE_DIR}/raw, the training did not run any instrumented program\")\n";
+    m << "endif()\n";
+    m << "if(LLVM_PROFDATA)\n";
+    m << "  execute_process(\n";
+    m << "    COMMAND ${LLVM_PROFDATA} merge -output=${PGO_PROFILE_DIR}/merged.profdata ${PGO_PROFILES}\n";
+    m << "    RESULT_VARIABLE PGO_MERGE_RESULT\n";
+    m << "    )\n";
+    m << "  if(PGO_MERGE_RESULT)\n";
+    m << "    message(FATAL_ERROR \"Failed to merge profiles\")\n";
+    m << "  endif()\n";
+    m << "endif()\n";
+    m << "# gcc merges counters of all runs directly into .gcda files\n";
+    m << "list(LENGTH PGO_PROFILES PGO_PROFILE_COUNT)\n";
+    m << "message(STATUS \"Merged ${PGO_PROFILE_COUNT} profiles\")\n";
+    m << "file(WRITE ${PGO_PROFILE_DIR}/compiler.stamp \"${PGO_COMPILER}\")\n";
+}
+
+///Writes the file only if its content differs, so the configuration depending on it is not repeated.
+///Returns true, if the file was written
+static bool write_if_different(const std::filesystem::path &file, const std::string &content) {
+    std::ifstream in(file, std::ios::binary);
+    if (in) {
+        std::ostringstream cur;
+        cur << in.rdbuf();
+        if (cur.str() == content) return false;
+    }
+    in.close();
+    std::ofstream out(file, std::ios::out|std::ios::trunc|std::ios::binary);
+    out << content;
+    return true;
+}
+
+static bool install_submodules_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ostringstream f;
+    f << "# Initializes git submodules during configuration\n";
+    f << "# The update is skipped when all submodules are already checked out at the recorded commits\n";
+    f << "# Nested submodules of libraries, which are also submodules of the project (the same URL), are not checked out,\n";
+    f << "# so every library has only one checkout\n";
+    f << "# SUBMODULE_DEFAULT_JOBS of the project is set by 'cxxproject add library <name> <url> --jobs <n>'\n";
+    f << "set(SUBMODULE_JOBS 0 CACHE STRING \"Count of submodules fetched in parallel (0 - SUBMODULE_DEFAULT_JOBS of the project or submodule.fetchJobs of git)\")\n";
+    f << "find_package(Git)\n";
+    f << "\n";
+    f << "# Reads paths and URLs (without .git) of submodules of the repository in DIR,\n";
+    f << "# relative URLs are resolved against BASE - URL of the repository\n";
+    f << "function(list_submodules DIR BASE PATHS URLS)\n";
+    f << "  set(P \"\")\n";
+    f << "  set(U \"\")\n";
+    f << "  if(EXISTS ${DIR}/.gitmodules)\n";
+    f << "    file(STRINGS ${DIR}/.gitmodules LINES)\n";
+    f << "    set(SUB_PATH \"\")\n";
+    f << "    set(SUB_URL \"\")\n";
+    f << "    # each section header (and the end of the file) completes the previous submodule\n";
+    f << "    foreach(LINE IN LISTS LINES ITEMS \"[]\")\n";
+    f << "      if(LINE MATCHES \"^[ \\t]*\\\\[\")\n";
+    f << "        if(SUB_PATH AND SUB_URL)\n";
+    f << "          set(B ${BASE})\n";
+    f << "          if(B AND SUB_URL MATCHES \"^\\\\.\\\\.?/\")\n";
+    f << "            while(SUB_URL MATCHES \"^(\\\\.\\\\.?)/(.*)$\")\n";
+    f << "              set(SUB_URL ${CMAKE_MATCH_2})\n";
+    f << "              if(CMAKE_MATCH_1 STREQUAL \"..\")\n";
+    f << "                string(REGEX REPLACE \"/[^/]*$\" \"\" B ${B})\n";
+    f << "              endif()\n";
+    f << "            endwhile()\n";
+    f << "            set(SUB_URL ${B}/${SUB_URL})\n";
+    f << "          endif()\n";
+    f << "          string(REGEX REPLACE \"/+$\" \"\" SUB_URL \"${SUB_URL}\")\n";
+    f << "          string(REGEX REPLACE \"\\\\.git$\" \"\" SUB_URL \"${SUB_URL}\")\n";
+    f << "          list(APPEND P ${SUB_PATH})\n";
+    f << "          list(APPEND U ${SUB_URL})\n";
+    f << "        endif()\n";
+    f << "        set(SUB_PATH \"\")\n";
+    f << "        set(SUB_URL \"\")\n";
+    f << "      elseif(LINE MATCHES \"^[ \\t]*path[ \\t]*=[ \\t]*([^ \\t]+)\")\n";
+    f << "        set(SUB_PATH ${CMAKE_MATCH_1})\n";
+    f << "      elseif(LINE MATCHES \"^[ \\t]*url[ \\t]*=[ \\t]*([^ \\t]+)\")\n";
+    f << "        set(SUB_URL ${CMAKE_MATCH_1})\n";
+    f << "      endif()\n";
+    f << "    endforeach()\n";
+    f << "  endif()\n";
+    f << "  set(${PATHS} ${P} PARENT_SCOPE)\n";
+    f << "  set(${URLS} ${U} PARENT_SCOPE)\n";
+    f << "endfunction()\n";
+    f << "\n";
+    f << "# Splits nested submodules of the library TOP (path of a submodule of the project) to INIT (checked out)\n";
+    f << "# and SKIP (duplicates of submodules of the project), the paths are relative to the library\n";
+    f << "function(nested_submodules TOP INIT SKIP)\n";
+    f << "  set(I \"\")\n";
+    f << "  set(S \"\")\n";
+    f << "  list(FIND SUBMODULE_PATHS ${TOP} INDEX)\n";
+    f << "  list(GET SUBMODULE_URLS ${INDEX} BASE)\n";
+    f << "  list_submodules(${CMAKE_SOURCE_DIR}/${TOP} ${BASE} NESTED_PATHS NESTED_URLS)\n";
+    f << "  list(LENGTH NESTED_PATHS COUNT)\n";
+    f << "  foreach(N RANGE ${COUNT})\n";
+    f << "    if(N LESS COUNT)\n";
+    f << "      list(GET NESTED_PATHS ${N} NESTED_PATH)\n";
+    f << "      list(GET NESTED_URLS ${N} NESTED_URL)\n";
+    f << "      list(FIND SUBMODULE_URLS ${NESTED_URL} FOUND)\n";
+    f << "      if(FOUND LESS 0)\n";
+    f << "        list(APPEND I ${NESTED_PATH})\n";
+    f << "      else()\n";
+    f << "        list(APPEND S ${NESTED_PATH})\n";
+    f << "      endif()\n";
+    f << "    endif()\n";
+    f << "  endforeach()\n";
+    f << "  set(${INIT} ${I} PARENT_SCOPE)\n";
+    f << "  set(${SKIP} ${S} PARENT_SCOPE)\n";
+    f << "endfunction()\n";
+    f << "\n";
+    f << "if(GIT_EXECUTABLE AND EXISTS ${CMAKE_SOURCE_DIR}/.gitmodules)\n";
+    f << "  list_submodules(${CMAKE_SOURCE_DIR} \"\" SUBMODULE_PATHS SUBMODULE_URLS)\n";
+    f << "  set(SUBMODULE_SKIP \"\")\n";
+    f << "  foreach(TOP ${SUBMODULE_PATHS})\n";
+    f << "    nested_submodules(${TOP} NESTED_INIT NESTED_SKIP)\n";
+    f << "    foreach(NESTED ${NESTED_SKIP})\n";
+    f << "      list(APPEND SUBMODULE_SKIP ${TOP}/${NESTED})\n";
+    f << "    endforeach()\n";
+    f << "  endforeach()\n";
+    f << "  execute_process(\n";
+    f << "    COMMAND ${GIT_EXECUTABLE} submodule status --recursive\n";
+    f << "    WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}\n";
+    f << "    OUTPUT_VARIABLE SUBMODULE_STATUS\n";
+    f << "    RESULT_VARIABLE SUBMODULE_STATUS_ERROR_CODE\n";
+    f << "    )\n";
+    f << "  # '-' - not initialized, '+' - checked out at different commit, 'U' - merge conflict\n";
+    f << "  set(SUBMODULE_OUTDATED ${SUBMODULE_STATUS_ERROR_CODE})\n";
+    f << "  string(REPLACE \"\\n\" \";\" SUBMODULE_STATUS \"${SUBMODULE_STATUS}\")\n";
+    f << "  foreach(LINE ${SUBMODULE_STATUS})\n";
+    f << "    if(LINE MATCHES \"^([-+U])[0-9a-f]+ ([^ ]+)\")\n";
+    f << "      list(FIND SUBMODULE_SKIP ${CMAKE_MATCH_2} FOUND)\n";
+    f << "      if(NOT CMAKE_MATCH_1 STREQUAL \"-\" OR FOUND LESS 0)\n";
+    f << "        set(SUBMODULE_OUTDATED ON)\n";
+    f << "      endif()\n";
+    f << "    endif()\n";
+    f << "  endforeach()\n";
+    f << "  if(SUBMODULE_OUTDATED)\n";
+    f << "    message(STATUS \"Updating git submodules\")\n";
+    f << "    # submodules marked by 'shallow = true' in .gitmodules are cloned without history\n";
+    f << "    if(SUBMODULE_JOBS)\n";
+    f << "      set(SUBMODULE_JOBS_ARG --jobs ${SUBMODULE_JOBS})\n";
+    f << "    elseif(SUBMODULE_DEFAULT_JOBS)\n";
+    f << "      set(SUBMODULE_JOBS_ARG --jobs ${SUBMODULE_DEFAULT_JOBS})\n";
+    f << "    endif()\n";
+    f << "    execute_process(\n";
+    f << "      COMMAND ${GIT_EXECUTABLE} submodule update --init --recommend-shallow ${SUBMODULE_JOBS_ARG}\n";
+    f << "      WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}\n";
+    f << "      RESULT_VARIABLE SUBMODULE_UPDATE_ERROR_CODE\n";
+    f << "      )\n";
+    f << "    # the libraries are checked out now, so their nested submodules are known\n";
+    f << "    foreach(TOP ${SUBMODULE_PATHS})\n";
+    f << "      nested_submodules(${TOP} NESTED_INIT NESTED_SKIP)\n";
+    f << "      if(NESTED_INIT)\n";
+    f << "        execute_process(\n";
+    f << "          COMMAND ${GIT_EXECUTABLE} submodule update --init --recursive --recommend-shallow ${SUBMODULE_JOBS_ARG} -- ${NESTED_INIT}\n";
+    f << "          WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}/${TOP}\n";
+    f << "          RESULT_VARIABLE NESTED_UPDATE_ERROR_CODE\n";
+    f << "          )\n";
+    f << "        if(NESTED_UPDATE_ERROR_CODE)\n";
+    f << "          set(SUBMODULE_UPDATE_ERROR_CODE ${NESTED_UPDATE_ERROR_CODE})\n";
+    f << "        endif()\n";
+    f << "      endif()\n";
+    f << "    endforeach()\n";
+    f << "    if(SUBMODULE_UPDATE_ERROR_CODE)\n";
+    f << "      message(FATAL_ERROR \"Failed to update git submodules\")\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "endif()\n";
+    return write_if_different(cmake_modules/"Submodules.cmake", f.str());
+}
+
+static void install_prebuilt_module() {
+    std::filesystem::create_directories(cmake_modules);
+    std::ofstream f(cmake_modules/"Prebuilt.cmake", std::ios::out|std::ios::trunc);
+    f << "# Libraries imported from git are built once per machine and installed into a content addressed cache.\n";
+    f << "# The key is the commit of the submodule, the compiler, the configurations and the build profile.\n";
+    f << "#   PREBUILT_DEPS       use (only existing packages), populate (missing packages are built during configuration), off\n";
+    f << "#   PREBUILT_CACHE_DIR  location of the cache\n";
+    f << "# The library is built from sources, if it has local changes or doesn't install <name>Config.cmake\n";
+    f << "set(PREBUILT_DEPS use CACHE STRING \"Prebuilt dependencies: use, populate, off\")\n";
+    f << "set_property(CACHE PREBUILT_DEPS PROPERTY STRINGS use populate off)\n";
+    f << "set(PREBUILT_MODULE ${CMAKE_CURRENT_LIST_FILE})\n";
+    f << "if(DEFINED ENV{XDG_CACHE_HOME})\n";
+    f << "  set(PREBUILT_CACHE_DIR $ENV{XDG_CACHE_HOME}/cxxproject/prebuilt CACHE PATH \"Cache of prebuilt dependencies\")\n";
+    f << "else()\n";
+    f << "  set(PREBUILT_CACHE_DIR $ENV{HOME}/.cache/cxxproject/prebuilt CACHE PATH \"Cache of prebuilt dependencies\")\n";
+    f << "endif()\n";
+    f << "find_package(Git)\n";
+    f << "\n";
+    f << "# Sets OUT to the prefix of the prebuilt package of the library in DIR, or to empty string\n";
+    f << "function(prebuilt_package NAME DIR OUT)\n";
+    f << "  set(${OUT} \"\" PARENT_SCOPE)\n";
+    f << "  # the build profile is passed by the Makefile to the main build trees only\n";
+    f << "  if(PREBUILT_DEPS STREQUAL \"off\" OR NOT GIT_EXECUTABLE OR NOT EXISTS \"${BUILD_PROFILE_FILE}\")\n";
+    f << "    return()\n";
+    f << "  endif()\n";
+    f << "  get_filename_component(DIR ${DIR} ABSOLUTE BASE_DIR ${CMAKE_SOURCE_DIR})\n";
+    f << "  execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse HEAD WORKING_DIRECTORY ${DIR}\n";
+    f << "    OUTPUT_VARIABLE COMMIT RESULT_VARIABLE COMMIT_ERROR_CODE OUTPUT_STRIP_TRAILING_WHITESPACE)\n";
+    f << "  execute_process(COMMAND ${GIT_EXECUTABLE} status --porcelain --untracked-files=no WORKING_DIRECTORY ${DIR}\n";
+    f << "    OUTPUT_VARIABLE CHANGES)\n";
+    f << "  if(COMMIT_ERROR_CODE OR CHANGES)\n";
+    f << "    return()\n";
+    f << "  endif()\n";
+    f << "  file(STRINGS ${BUILD_PROFILE_FILE} PROFILE_LINES REGEX \"^[ \\t]*[^# \\t]\")\n";
+    f << "  string(JOIN \" \" PROFILE_ARGS ${PROFILE_LINES})\n";
+    f << "  separate_arguments(PROFILE_ARGS UNIX_COMMAND \"${PROFILE_ARGS}\")\n";
+    f << "  if(CMAKE_CONFIGURATION_TYPES)\n";
+    f << "    set(CONFIGS ${CMAKE_CONFIGURATION_TYPES})\n";
+    f << "  else()\n";
+    f << "    set(CONFIGS ${CMAKE_BUILD_TYPE})\n";
+    f << "  endif()\n";
+    f << "  set(KEY \"${COMMIT}|${CMAKE_CXX_COMPILER}|${CMAKE_CXX_COMPILER_ID}|${CMAKE_CXX_COMPILER_VERSION}|\")\n";
+    f << "  string(APPEND KEY \"${CMAKE_GENERATOR}|${CONFIGS}|${CMAKE_CXX_FLAGS}|${PROFILE_ARGS}\")\n";
+    f << "  string(SHA256 KEY \"${KEY}\")\n";
+    f << "  string(SUBSTRING ${KEY} 0 32 KEY)\n";
+    f << "  set(PREFIX ${PREBUILT_CACHE_DIR}/${NAME}/${KEY})\n";
+    f << "  if(NOT EXISTS ${PREFIX}/lib/cmake/${NAME}/${NAME}Config.cmake)\n";
+    f << "    if(NOT PREBUILT_DEPS STREQUAL \"populate\")\n";
+    f << "      return()\n";
+    f << "    endif()\n";
+    f << "    # a failed build is not repeated, its log is in <prefix>.failed; the key covers the sources, compiler\n";
+    f << "    # and profile, so the failure expires when this module changes or the file is deleted\n";
+    f << "    if(EXISTS ${PREFIX}.failed AND ${PREFIX}.failed IS_NEWER_THAN ${PREBUILT_MODULE})\n";
+    f << "      return()\n";
+    f << "    endif()\n";
+    f << "    message(STATUS \"Building prebuilt ${NAME} (${COMMIT})\")\n";
+    f << "    # concurrent configurations build in separate directories, the first finished is moved to the cache\n";
+    f << "    string(RANDOM LENGTH 8 WORK)\n";
+    f << "    set(WORK ${PREFIX}.${WORK}.tmp)\n";
+    f << "    # the library is built from its own clone, so its submodules don't appear in the project\n";
+    f << "    execute_process(COMMAND ${GIT_EXECUTABLE} clone --quiet --shared --no-checkout ${DIR} ${WORK}/src\n";
+    f << "      OUTPUT_VARIABLE LOG ERROR_VARIABLE LOG RESULT_VARIABLE ERROR_CODE)\n";
+    f << "    if(NOT ERROR_CODE)\n";
+    f << "      execute_process(COMMAND ${GIT_EXECUTABLE} checkout --quiet ${COMMIT} WORKING_DIRECTORY ${WORK}/src\n";
+    f << "        OUTPUT_VARIABLE LOG ERROR_VARIABLE LOG RESULT_VARIABLE ERROR_CODE)\n";
+    f << "    endif()\n";
+    f << "    if(NOT ERROR_CODE)\n";
+    f << "      execute_process(COMMAND ${CMAKE_COMMAND} -G ${CMAKE_GENERATOR} -S ${WORK}/src -B ${WORK}/build\n";
+    f << "          -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER} -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER}\n";
+    f << "          -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE} \"-DCMAKE_CONFIGURATION_TYPES=${CMAKE_CONFIGURATION_TYPES}\"\n";
+    f << "          -DCMAKE_INSTALL_PREFIX=${WORK}/install -DBUILD_PROFILE_FILE=${BUILD_PROFILE_FILE}\n";
+    f << "          -DPREBUILT_DEPS=${PREBUILT_DEPS} -DPREBUILT_CACHE_DIR=${PREBUILT_CACHE_DIR} ${PROFILE_ARGS}\n";
+    f << "        OUTPUT_VARIABLE LOG ERROR_VARIABLE LOG RESULT_VARIABLE ERROR_CODE)\n";
+    f << "    endif()\n";
+    f << "    foreach(CONFIG ${CONFIGS})\n";
+    f << "      if(NOT ERROR_CODE)\n";
+    f << "        execute_process(COMMAND ${CMAKE_COMMAND} --build ${WORK}/build --config ${CONFIG} --target ${NAME}\n";
+    f << "          OUTPUT_VARIABLE BUILD_LOG ERROR_VARIABLE BUILD_LOG RESULT_VARIABLE ERROR_CODE)\n";
+    f << "        string(APPEND LOG \"${BUILD_LOG}\")\n";
+    f << "      endif()\n";
+    f << "      if(NOT ERROR_CODE)\n";
+    f << "        execute_process(COMMAND ${CMAKE_COMMAND} --install ${WORK}/build --config ${CONFIG}\n";
+    f << "          OUTPUT_VARIABLE BUILD_LOG ERROR_VARIABLE BUILD_LOG RESULT_VARIABLE ERROR_CODE)\n";
+    f << "        string(APPEND LOG \"${BUILD_LOG}\")\n";
+    f << "      endif()\n";
+    f << "    endforeach()\n";
+    f << "    if(NOT ERROR_CODE AND EXISTS ${WORK}/install/lib/cmake/${NAME}/${NAME}Config.cmake)\n";
+    f << "      execute_process(COMMAND ${CMAKE_COMMAND} -E rename ${WORK}/install ${PREFIX} RESULT_VARIABLE ERROR_CODE)\n";
+    f << "    else()\n";
+    f << "      message(STATUS \"Prebuilt ${NAME} is not available, it is built from sources (log: ${PREFIX}.failed)\")\n";
+    f << "      file(WRITE ${PREFIX}.failed \"${LOG}\")\n";
+    f << "    endif()\n";
+    f << "    file(REMOVE_RECURSE ${WORK})\n";
+    f << "    if(NOT EXISTS ${PREFIX}/lib/cmake/${NAME}/${NAME}Config.cmake)\n";
+    f << "      return()\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "  message(STATUS \"Using prebuilt ${NAME}: ${PREFIX}\")\n";
+    f << "  set(${OUT} ${PREFIX} PARENT_SCOPE)\n";
+    f << "endfunction()\n";
+    f << "\n";
+    f << "# Imports the library from git submodule in DIR - the prebuilt package, or the sources by its library.cmake\n";
+    f << "# A library imported by more libraries is imported only once\n";
+    f << "macro(import_library NAME DIR)\n";
+    f << "  if(NOT TARGET ${NAME})\n";
+    f << "    prebuilt_package(${NAME} ${DIR} PREBUILT_PREFIX)\n";
+    f << "    if(PREBUILT_PREFIX)\n";
+    f << "      find_package(${NAME} CONFIG REQUIRED PATHS ${PREBUILT_PREFIX} NO_DEFAULT_PATH)\n";
+    f << "    else()\n";
+    f << "      include(${DIR}/library.cmake)\n";
+    f << "    endif()\n";
+    f << "  endif()\n";
+    f << "endmacro()\n";
+}
 
 static void version_build_files(std::string name) {
     std::string capname;
     std::transform(name.begin(), name.end(), std::back_inserter(capname), toupper);
     std::filesystem::create_directories("version");
     std::ofstream cmake("version/CMakeLists.txt", std::ios::out|std::ios::trunc);
-    cmake << "add_custom_target(" << name << "_version\n";
-    cmake <<"    ${CMAKE_COMMAND} -D SRC=${CMAKE_SOURCE_DIR}/version/version.h.in\n";
-    cmake <<"          -D DST=${CMAKE_BINARY_DIR}/src/" << name << "_version.h\n";
-    cmake <<"          -D ROOT=${CMAKE_SOURCE_DIR}\n";
-    cmake <<"          -D GIT_EXECUTABLE=${GIT_EXECUTABLE}\n";
-    cmake <<"          -P ${CMAKE_CURRENT_LIST_DIR}/GenerateVersionHeader.cmake\n";
-    cmake <<"          )\n";
+    cmake << "# The version is compiled into a separate library, so a new version relinks the project,\n";
+    cmake << "# but does not recompile sources including " << name << "_version.h\n";
+    cmake << "configure_file(${CMAKE_CURRENT_LIST_DIR}/version.h.in ${CMAKE_BINARY_DIR}/src/" << name << "_version.h COPYONLY)\n";
+    cmake << "\n";
+    cmake << "set(VERSION_DEPENDS ${CMAKE_CURRENT_LIST_DIR}/version.cpp.in ${CMAKE_CURRENT_LIST_DIR}/GenerateVersionHeader.cmake)\n";
+    cmake << "if(GIT_EXECUTABLE)\n";
+    cmake << "  execute_process(\n";
+    cmake << "    COMMAND ${GIT_EXECUTABLE} rev-parse --git-dir --git-common-dir\n";
+    cmake << "    WORKING_DIRECTORY ${CMAKE_CURRENT_LIST_DIR}\n";
+    cmake << "    OUTPUT_VARIABLE GIT_DIRS\n";
+    cmake << "    RESULT_VARIABLE GIT_DIRS_ERROR_CODE\n";
+    cmake << "    OUTPUT_STRIP_TRAILING_WHITESPACE\n";
+    cmake << "    )\n";
+    cmake << "  if(NOT GIT_DIRS_ERROR_CODE)\n";
+    cmake << "    string(REPLACE \"\\n\" \";\" GIT_DIRS \"${GIT_DIRS}\")\n";
+    cmake << "    list(GET GIT_DIRS 0 GIT_DIR)\n";
+    cmake << "    list(GET GIT_DIRS -1 GIT_COMMON_DIR)\n";
+    cmake << "    get_filename_component(GIT_DIR ${GIT_DIR} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_LIST_DIR})\n";
+    cmake << "    get_filename_component(GIT_COMMON_DIR ${GIT_COMMON_DIR} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_LIST_DIR})\n";
+    cmake << "    # logs/HEAD is appended by every commit, checkout and reset, new tags change refs/tags or packed-refs\n";
+    cmake << "    foreach(GIT_FILE ${GIT_DIR}/HEAD ${GIT_DIR}/logs/HEAD ${GIT_COMMON_DIR}/packed-refs ${GIT_COMMON_DIR}/refs/tags)\n";
+    cmake << "      if(EXISTS ${GIT_FILE})\n";
+    cmake << "        list(APPEND VERSION_DEPENDS ${GIT_FILE})\n";
+    cmake << "      endif()\n";
+    cmake << "    endforeach()\n";
+    cmake << "  endif()\n";
+    cmake << "endif()\n";
+    cmake << "\n";
+    cmake << "# the stamp is newer than the git files, the source is written only if the version changes,\n";
+    cmake << "# so a commit, fetch or tag not changing the version doesn't recompile it\n";
+    cmake << "add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/version.stamp\n";
+    cmake << "    BYPRODUCTS ${CMAKE_BINARY_DIR}/src/" << name << "_version.cpp\n";
+    cmake << "    COMMAND ${CMAKE_COMMAND} -D SRC=${CMAKE_CURRENT_LIST_DIR}/version.cpp.in\n";
+    cmake << "          -D DST=${CMAKE_BINARY_DIR}/src/" << name << "_version.cpp\n";
+    cmake << "          -D STAMP=${CMAKE_CURRENT_BINARY_DIR}/version.stamp\n";
+    cmake << "          -D ROOT=${CMAKE_SOURCE_DIR}\n";
+    cmake << "          -D GIT_EXECUTABLE=${GIT_EXECUTABLE}\n";
+    cmake << "          -P ${CMAKE_CURRENT_LIST_DIR}/GenerateVersionHeader.cmake\n";
+    cmake << "    DEPENDS ${VERSION_DEPENDS}\n";
+    cmake << "    )\n";
+    cmake << "add_library(" << name << "_version STATIC ${CMAKE_BINARY_DIR}/src/" << name << "_version.cpp ${CMAKE_CURRENT_BINARY_DIR}/version.stamp)\n";
+    //can be linked into shared libraries
+    cmake << "set_target_properties(" << name << "_version PROPERTIES POSITION_INDEPENDENT_CODE ON)\n";
     cmake.close();
 
     std::ofstream gen("version/GenerateVersionHeader.cmake", std::ios::out|std::ios::trunc);
@@ -152,21 +1510,30 @@ static void version_build_files(std::string name) {
     gen << "  message(WARNING \"Failed to determine version from Git tags. Using default version \\\"${PROJECT_VERSION}\\\".\")\n";
     gen << "endif()\n";
     gen << "\n";
+    gen << "# the file is not modified, if the version is the same\n";
     gen << "configure_file(${SRC} ${DST} @ONLY)\n";
+    gen << "file(TOUCH ${STAMP})\n";
 
     gen.close();
 
 
     std::ofstream hdr("version/version.h.in", std::ios::out|std::ios::trunc);
-    hdr << "#define PROJECT_" << capname << "_VERSION \"@PROJECT_VERSION@\"" << std::endl;
+    hdr << "#pragma once\n";
+    hdr << "extern const char project_" << name << "_version[];\n";
+    hdr << "#define PROJECT_" << capname << "_VERSION project_" << name << "_version" << std::endl;
     hdr.close();
+
+    std::ofstream cpp("version/version.cpp.in", std::ios::out|std::ios::trunc);
+    cpp << "#include <" << name << "_version.h>\n";
+    cpp << "const char project_" << name << "_version[] = \"@PROJECT_VERSION@\";" << std::endl;
+    cpp.close();
 }
 
 
 #define SYSTEM(X) do { int r = system((X)); if (r) throw std::system_error(r, std::system_category(), #X); } while(false)
 
 template<typename Spec>
-static void create_project_skeleton(std::string name, Spec spec) {
+static void create_project_skeleton(std::string name, Generator gen, Spec spec) {
 
     std::ofstream f(CMakeLists, std::ios::out| std::ios::trunc);
     if (!f) {
@@ -188,13 +1555,21 @@ static void create_project_skeleton(std::string name, Spec spec) {
          "\tset(STANDARD_LIBRARIES \"pthread\")\n"
          "endif()\n"
          "add_compile_options(-Wall -Wno-noexcept-type)\n"
-         "find_package(Git)\n"
-         "if(GIT_EXECUTABLE)\n"
-         "\texecute_process(COMMAND ${GIT_EXECUTABLE} submodule update --init WORKING_DIRECTORY ${CMAKE_SOURCE_DIR})\n"
-         "endif()\n"
-         "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/bin/)\n"
-         "set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/lib/)\n"
-         "set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/lib/)\n"
+         BUILD_PROFILE_FILE_DEFINITION
+         "include(cmake/CompilerCache.cmake)\n"
+         "include(cmake/UnityBuild.cmake)\n"
+         "include(cmake/PGO.cmake)\n"
+         "include(cmake/Optimization.cmake)\n"
+         "include(cmake/Profiling.cmake)\n"
+         "include(cmake/FastLink.cmake)\n"
+         "include(cmake/BuildTrace.cmake)\n"
+         "include(cmake/Submodules.cmake)\n"
+         "include(cmake/Prebuilt.cmake)\n"
+         "include(cmake/MultiIsa.cmake)\n"
+         OUTPUT_DIR_DEFINITION
+         "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${OUTPUT_DIR}/bin/)\n"
+         "set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${OUTPUT_DIR}/lib/)\n"
+         "set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${OUTPUT_DIR}/lib/)\n"
          "if(CMAKE_INSTALL_PREFIX_INITIALIZED_TO_DEFAULT)\n"
          "\tset(CMAKE_INSTALL_PREFIX \"/usr/local\" CACHE PATH \"Default path to install\" FORCE)\n"
          "endif()\n"
@@ -204,18 +1579,33 @@ static void create_project_skeleton(std::string name, Spec spec) {
     create_directories(src);
     create_directories(src/name);
 
-    spec(f);
-
+    //the version library must exist before install rules of the library
     f << "add_subdirectory(\"version\")\n";
 
+    spec(f);
+
     f.close();
 
     SYSTEM("git init");
 
-    install_makefile();
+    install_makefile(gen);
     install_gitignore();
     install_default_build_profile();
-    SYSTEM("git add src Makefile " CMakeLists " .gitignore default_build_profile.conf");
+    install_compiler_cache_module();
+    install_unity_build_module();
+    install_pgo_module();
+    install_optimization_module();
+    install_profiling_module();
+    install_perf_check_scripts();
+    install_fast_link_module();
+    install_build_trace_module();
+    install_submodules_module();
+    install_prebuilt_module();
+    install_multi_isa_module();
+    for (const auto &t: profile_templates) install_profile(t);
+    SYSTEM("git add src version cmake profiles Makefile " CMakeLists " .gitignore default_build_profile.conf");
+    //projects importing the library from git need it in the first commit
+    if (exists("library.cmake")) SYSTEM("git add library.cmake");
     SYSTEM("git commit -m 'Project creation'");
     SYSTEM("git tag 0.0.1");
     std::cout << std::endl;
@@ -226,7 +1616,7 @@ static void create_project_skeleton(std::string name, Spec spec) {
 
 }
 
-static void create_main_source(std::string name, bool exec, bool header) {
+static void create_main_source(std::string name, bool exec, bool header, bool tracing = false) {
 
     std::string capname;
     std::transform(name.begin(), name.end(), std::back_inserter(capname), toupper);
@@ -241,7 +1631,16 @@ static void create_main_source(std::string name, bool exec, bool header) {
         }
         if (exec) {
             x << "#include <iostream>\n#include <cstdlib>\n\n";
-            x << "int main(int argc, char **argv) {\n    std::cout << \"Version: \" << PROJECT_" << capname << "_VERSION << std::endl;\n    return 0;\n}\n";
+            if (tracing) {
+                x << "#include <cxxtrace/cxxtrace.h>\n\n";
+                x << "int main(int argc, char **argv) {\n    CXXTRACE_SCOPE(\"main\");\n";
+                if (header) x << "    std::cout << \"Version: \" << PROJECT_" << capname << "_VERSION << std::endl;\n";
+                x << "    return 0;\n}\n";
+            } else if (header) {
+                x << "int main(int argc, char **argv) {\n    std::cout << \"Version: \" << PROJECT_" << capname << "_VERSION << std::endl;\n    return 0;\n}\n";
+            } else {
+                x << "int main(int argc, char **argv) {\n    return 0;\n}\n";
+            }
         } else {
             x << "namespace " << name << "{\n\n}\n";
         }
@@ -267,7 +1666,7 @@ static std::string generate_guard(std::string name) {
     return out;
 }
 
-static void create_main_header(std::string name, bool exec) {
+static void create_main_header(std::string name, bool exec, LibraryKind kind = LibraryKind::static_lib) {
     std::filesystem::path source = src/name/name;
     source.replace_extension("h");
     if (!std::filesystem::exists(source)) {
@@ -276,28 +1675,81 @@ static void create_main_header(std::string name, bool exec) {
         x << "#pragma once\n";
         x << "#ifndef " << guard << "\n";
         x << "#define " << guard << "\n\n";
+        if (kind == LibraryKind::shared) {
+            std::string capname;
+            std::transform(name.begin(), name.end(), std::back_inserter(capname), toupper);
+            x << "#include <" << name << "/" << name << "_export.h>\n\n";
+            x << "//symbols are hidden by default, mark exported classes and functions by " << capname << "_EXPORT\n";
+        }
         if (!exec) {
             x << "namespace " << name << "{\n\n}\n\n";
         }
         x << "#endif /* " << guard << " */\n";
     }}
 
-static void create_test_source(std::string name, std::string test_dir) {
+///Creates primary module interface unit <name>.cppm and implementation unit <name>.cpp
+static void create_module_sources(std::string name, LibraryKind kind) {
+    std::string capname;
+    std::transform(name.begin(), name.end(), std::back_inserter(capname), toupper);
+    std::filesystem::path iface = src/name/(name+".cppm");
+    if (!std::filesystem::exists(iface)) {
+        std::ofstream x(iface, std::ios::out);
+        x << "module;\n\n";
+        x << "//headers used by the module are included here (global module fragment)\n";
+        if (kind == LibraryKind::shared) {
+            x << "#include <" << name << "/" << name << "_export.h>\n\n";
+            x << "//symbols are hidden by default, mark exported classes and functions by " << capname << "_EXPORT\n";
+        }
+        x << "\nexport module " << name << ";\n\n";
+        x << "export namespace " << name << "{\n\n";
+        x << "///Returns name of the module, called by the tests through import\n";
+        x << (kind == LibraryKind::shared?capname+"_EXPORT ":"") << "const char *module_name();\n\n}\n";
+    }
+    std::filesystem::path impl = src/name/(name+".cpp");
+    if (!std::filesystem::exists(impl)) {
+        std::ofstream x(impl, std::ios::out);
+        x << "module " << name << ";\n\n";
+        x << "namespace " << name << "{\n\n";
+        x << "const char *module_name() {\n    return \"" << name << "\";\n}\n\n}\n";
+    }
+}
+
+static void create_test_source(std::string name, std::string test_dir, bool single_binary, bool modules = false) {
     std::filesystem::path source = src/test_dir/"compile_test.cpp";
     if (!std::filesystem::exists(source)) {
         std::ofstream x(source, std::ios::out);
-        if (!name.empty()) {
+        if (!name.empty() && !modules) {
             x << "#include <" << name << "/" << name << ".h>\n\n";
         }
-        x << "#include <iostream>\n#include <cstdlib>\n\n";
+        if (single_binary) {
+            x << "#include <cxxtest/cxxtest.h>\n\n";
+        } else {
+            x << "#include <iostream>\n#include <cstdlib>\n\n";
+        }
+        if (!name.empty() && modules) {
+            x << "import " << name << ";\n\n";
+        }
         if (!name.empty()) {
             x <<"using namespace " << name << ";\n\n";
         }
-        x << "int main(int argc, char **argv) {\n    return 0;\n}\n";
+        if (single_binary) {
+            if (!name.empty() && modules) x << "CXXTEST(compile_test) {\n    CXXTEST_CHECK(module_name() != nullptr);\n}\n";
+            else x << "CXXTEST(compile_test) {\n    CXXTEST_CHECK(true);\n}\n";
+        } else {
+            if (!name.empty() && modules) x << "int main(int argc, char **argv) {\n    return module_name() != nullptr?0:1;\n}\n";
+            else x << "int main(int argc, char **argv) {\n    return 0;\n}\n";
+        }
     }
 }
 
-static void create_exec_cmake(std::string name, bool version) {
+static void target_options_cmake(std::ostream &f, std::string name, const TargetOptions &opts) {
+    if (opts.unity) {
+        f << "# Sources which cannot be merged into unity build can be listed after EXCLUDE\n";
+        f << "target_unity_build(" << name << " EXCLUDE)\n";
+    }
+}
+
+static void create_exec_cmake(std::string name, bool version, const TargetOptions &opts) {
     std::string sublists = src/name/CMakeLists;
     std::ofstream f(sublists, std::ios::out| std::ios::trunc);
     if (!f) {
@@ -307,26 +1759,121 @@ static void create_exec_cmake(std::string name, bool version) {
     f <<  CMAKE_HEADER "\n";
     f << "add_executable(" << name << "\n\t" << name << ".cpp\n)\n\n";
     f << "target_link_libraries(" << name << "\n\t${STANDARD_LIBRARIES}\n)\n";
+    target_options_cmake(f, name, opts);
+    if (opts.tracing)
+        f << "target_link_libraries(" << name << " cxxtrace)\n";
     if (version)
-        f << "add_dependencies(" << name << " " << name << "_version)\n\n";
+        f << "target_link_libraries(" << name << " " << name << "_version)\n\n";
+    f << "multi_isa_executable(" << name << ")\n";
+}
 
+///Installs the main library of a library project as CMake package <name>Config.cmake,
+///which is used by find_package() and by the prebuilt cache of the importing projects
+static void package_cmake(std::ostream &f, std::string name, const TargetOptions &opts) {
+    //the library built from sources by an importing project is installed by that project
+    f << "if(CMAKE_CURRENT_SOURCE_DIR STREQUAL \"${CMAKE_SOURCE_DIR}/src/" << name << "\")\n";
+    f << "  include(GNUInstallDirs)\n";
+    f << "  target_include_directories(" << name << " INTERFACE $<INSTALL_INTERFACE:${CMAKE_INSTALL_INCLUDEDIR}>)\n";
+    f << "  function(install_" << name << "_package)\n";
+    f << "    include(GNUInstallDirs)\n";
+    //arguments of the deferred call would be expanded in the root directory, an interface library is defined by library.cmake
+    f << "    set(SOURCE_DIR ${CMAKE_SOURCE_DIR}/src/" << name << ")\n";
+    f << "    set(BINARY_DIR ${CMAKE_BINARY_DIR}/src/" << name << ")\n";
+    f << "    # other libraries of the project would have to be exported with the library, so a library\n";
+    f << "    # linking them is not installed as package and the importing projects build it from sources\n";
+    if (opts.kind != LibraryKind::interface)
+        f << "    get_target_property(LIBS " << name << " LINK_LIBRARIES)\n";
+    f << "    get_target_property(INTERFACE_LIBS " << name << " INTERFACE_LINK_LIBRARIES)\n";
+    f << "    foreach(LIB ${LIBS} ${INTERFACE_LIBS})\n";
+    f << "      if(LIB MATCHES \"^\\\\$<LINK_ONLY:(.*)>$\")\n";
+    f << "        set(LIB ${CMAKE_MATCH_1})\n";
+    f << "      endif()\n";
+    f << "      if(TARGET ${LIB} AND NOT LIB STREQUAL \"" << name << "_version\")\n";
+    f << "        get_target_property(IMPORTED ${LIB} IMPORTED)\n";
+    f << "        if(NOT IMPORTED)\n";
+    f << "          message(STATUS \"" << name << " links ${LIB} of the project, it is not installed as package\")\n";
+    f << "          return()\n";
+    f << "        endif()\n";
+    f << "      endif()\n";
+    f << "    endforeach()\n";
+    if (opts.kind == LibraryKind::interface) {
+        //header-only library has no binaries and no version library
+        f << "    install(TARGETS " << name << " EXPORT " << name << "Targets)\n";
+    } else {
+        f << "    install(TARGETS " << name << " " << name << "_version EXPORT " << name << "Targets\n";
+        f << "      ARCHIVE DESTINATION ${CMAKE_INSTALL_LIBDIR}\n";
+        f << "      LIBRARY DESTINATION ${CMAKE_INSTALL_LIBDIR}\n";
+        f << "      RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR}\n";
+        if (opts.kind == LibraryKind::object)
+            f << "      OBJECTS DESTINATION ${CMAKE_INSTALL_LIBDIR}/" << name << "\n";
+        if (opts.modules)
+            f << "      FILE_SET CXX_MODULES DESTINATION ${CMAKE_INSTALL_LIBDIR}/cmake/" << name << "/src\n";
+        f << "      )\n";
+    }
+    //only the headers of the library directory, so <name/name.h> resolves against include/
+    f << "    file(GLOB HEADERS ${SOURCE_DIR}/*.h ${SOURCE_DIR}/*.hpp)\n";
+    f << "    install(FILES ${HEADERS} DESTINATION ${CMAKE_INSTALL_INCLUDEDIR}/" << name << ")\n";
+    if (opts.kind == LibraryKind::shared)
+        f << "    install(DIRECTORY ${BINARY_DIR}/include/ DESTINATION ${CMAKE_INSTALL_INCLUDEDIR})\n";
+    f << "    install(EXPORT " << name << "Targets DESTINATION ${CMAKE_INSTALL_LIBDIR}/cmake/" << name;
+    if (opts.modules) f << " CXX_MODULES_DIRECTORY modules";
+    f << ")\n";
+    f << "    file(WRITE ${BINARY_DIR}/" << name << "Config.cmake \"include(\\${CMAKE_CURRENT_LIST_DIR}/" << name << "Targets.cmake)\\n\")\n";
+    f << "    install(FILES ${BINARY_DIR}/" << name << "Config.cmake DESTINATION ${CMAKE_INSTALL_LIBDIR}/cmake/" << name << ")\n";
+    f << "  endfunction()\n";
+    f << "  # linked libraries are defined at the end of the project (import_library() follows library.cmake)\n";
+    f << "  if(CMAKE_VERSION VERSION_LESS 3.19)\n";
+    f << "    install_" << name << "_package()\n";
+    f << "  else()\n";
+    f << "    cmake_language(DEFER DIRECTORY ${CMAKE_SOURCE_DIR} CALL install_" << name << "_package)\n";
+    f << "  endif()\n";
+    f << "endif()\n";
 }
 
-static void create_lib_cmake(std::string name, bool version) {
+static void create_lib_cmake(std::string name, bool version, const TargetOptions &opts) {
     std::string sublists = src/name/CMakeLists;
     std::ofstream f(sublists, std::ios::out| std::ios::trunc);
     if (!f) {
         int e = errno;
         throw std::system_error(e, std::system_category(), "Failed to open "+sublists);
     }
-    f << CMAKE_HEADER "\n";
-    f << "add_library(" << name << "\n\t" << name << ".cpp\n)\n";
-    if (version)
-        f << "add_dependencies(" << name << " " << name << "_version)\n\n";
+    //CMake scans dependencies of modules since 3.28
+    if (opts.modules) f << "cmake_minimum_required(VERSION 3.28)\n\n";
+    else f << CMAKE_HEADER "\n";
+    switch (opts.kind) {
+        case LibraryKind::interface:
+            //the header-only library of a library project is defined by library.cmake, the directory installs it
+            if (version) package_cmake(f, name, opts);
+            else f << "add_library(" << name << " INTERFACE)\n";
+            return;
+        case LibraryKind::object:
+            f << "add_library(" << name << " OBJECT\n\t" << name << ".cpp\n)\n";
+            break;
+        case LibraryKind::shared:
+            f << "add_library(" << name << " SHARED\n\t" << name << ".cpp\n)\n";
+            //only symbols marked by the export macro are exported
+            f << "set_target_properties(" << name << " PROPERTIES CXX_VISIBILITY_PRESET hidden VISIBILITY_INLINES_HIDDEN ON)\n";
+            f << "include(GenerateExportHeader)\n";
+            f << "generate_export_header(" << name << " EXPORT_FILE_NAME ${CMAKE_CURRENT_BINARY_DIR}/include/" << name << "/" << name << "_export.h)\n";
+            f << "target_include_directories(" << name << " PUBLIC $<BUILD_INTERFACE:${CMAKE_CURRENT_BINARY_DIR}/include>)\n";
+            break;
+        default:
+            f << "add_library(" << name << "\n\t" << name << ".cpp\n)\n";
+            break;
+    }
+    if (opts.modules) {
+        f << "target_sources(" << name << " PUBLIC FILE_SET CXX_MODULES FILES\n\t" << name << ".cppm\n)\n";
+        f << "target_compile_features(" << name << " PUBLIC cxx_std_20)\n";
+    }
+    target_options_cmake(f, name, opts);
+    if (version) {
+        f << "target_link_libraries(" << name << " " << name << "_version)\n\n";
+        package_cmake(f, name, opts);
+    }
 
 }
 
-static void create_test_cmake(std::string name, std::string test_dir) {
+static void create_test_cmake(std::string name, std::string test_dir, bool single_binary) {
     std::string sublists = src/test_dir/CMakeLists;
     std::ofstream f(sublists, std::ios::out| std::ios::trunc);
     if (!f) {
@@ -340,128 +1887,1147 @@ static void create_test_cmake(std::string name, std::string test_dir) {
          "\tcompile_test.cpp\n"
          ")\n\n"
 
-         "link_libraries(\n\t" << name << "\n\t${STANDARD_LIBRARIES}\n)\n\n"
+         "link_libraries(\n\t" << name << "\n\t${STANDARD_LIBRARIES}\n)\n\n";
+    if (single_binary) {
+        //one link for all test files, each file is still a separate test of ctest
+        f << "add_executable(" << test_dir << "_all ${testFiles} ${CMAKE_CURRENT_SOURCE_DIR}/../cxxtest/cxxtest_main.cpp)\n"
+             "foreach (testFile ${testFiles})\n"
+                "\tstring(REGEX MATCH \"([^\\/]+$)\" filename ${testFile})\n"
+                "\tadd_test(NAME \"" << test_dir << "/${filename}\" COMMAND " << test_dir << "_all --file ${filename})\n"
+             "endforeach ()\n";
+    } else {
+        f << "foreach (testFile ${testFiles})\n"
+                "\tstring(REGEX MATCH \"([^\\/]+$)\" filename ${testFile})\n"
+                "\tstring(REGEX MATCH \"[^.]*\" executable_name " << test_dir << "_${filename})\n"
+                "\tadd_executable(${executable_name} ${testFile})\n"
+                "\ttarget_link_libraries(${executable_name} ${STANDARD_LIBRARIES} )\n"
+                "\tadd_test(NAME \"" << test_dir << "/${filename}\" COMMAND ${executable_name})\n"
+            "endforeach ()\n";
+    }
 
-        "foreach (testFile ${testFiles})\n"
-            "\tstring(REGEX MATCH \"([^\\/]+$)\" filename ${testFile})\n"
-            "\tstring(REGEX MATCH \"[^.]*\" executable_name " << test_dir << "_${filename})\n"
-            "\tadd_executable(${executable_name} ${testFile})\n"
-            "\ttarget_link_libraries(${executable_name} ${STANDARD_LIBRARIES} )\n"
-            "\tadd_test(NAME \"" << test_dir << "/${filename}\" COMMAND ${executable_name})\n"
-        "endforeach ()\n";
 
+}
+
+///Test of a library project, which installs the library to the build tree and builds a project using
+///the installed package by find_package()
+static void create_package_test(std::string name, bool modules) {
+    std::filesystem::path dir = src_tests/"package";
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream f(dir/"package_test.cmake", std::ios::out|std::ios::trunc);
+        f << "# Installs the library to the build tree and builds a project, which finds it by find_package()\n";
+        f << "# cmake -D BINARY_DIR=<root build dir> -D CONFIG=<config> -D GENERATOR=<generator> -D CXX_COMPILER=<compiler> -P package_test.cmake\n";
+        f << "set(TEST_DIR ${BINARY_DIR}/package_test)\n";
+        f << "file(REMOVE_RECURSE ${TEST_DIR})\n";
+        f << "if(CONFIG)\n";
+        f << "  set(CONFIG_ARGS --config ${CONFIG})\n";
+        f << "endif()\n";
+        f << "execute_process(COMMAND ${CMAKE_COMMAND} --install ${BINARY_DIR} ${CONFIG_ARGS} --prefix ${TEST_DIR}/prefix\n";
+        f << "  RESULT_VARIABLE RESULT)\n";
+        f << "if(RESULT)\n";
+        f << "  message(FATAL_ERROR \"Installation of the package failed\")\n";
+        f << "endif()\n";
+        f << "file(GLOB_RECURSE CONFIG_FILE ${TEST_DIR}/prefix/*Config.cmake)\n";
+        f << "if(NOT CONFIG_FILE)\n";
+        f << "  # the library links other libraries of the project, see install_<name>_package()\n";
+        f << "  message(STATUS \"The library is not installed as package, nothing to test\")\n";
+        f << "  return()\n";
+        f << "endif()\n";
+        f << "execute_process(COMMAND ${CMAKE_COMMAND} -S ${CMAKE_CURRENT_LIST_DIR} -B ${TEST_DIR}/build -G ${GENERATOR}\n";
+        f << "  -D CMAKE_CXX_COMPILER=${CXX_COMPILER} -D CMAKE_BUILD_TYPE=${CONFIG} -D CMAKE_PREFIX_PATH=${TEST_DIR}/prefix\n";
+        f << "  RESULT_VARIABLE RESULT)\n";
+        f << "if(NOT RESULT)\n";
+        f << "  execute_process(COMMAND ${CMAKE_COMMAND} --build ${TEST_DIR}/build ${CONFIG_ARGS} RESULT_VARIABLE RESULT)\n";
+        f << "endif()\n";
+        f << "if(RESULT)\n";
+        f << "  message(FATAL_ERROR \"The project using the installed package failed to build\")\n";
+        f << "endif()\n";
+    }
+    {
+        std::ofstream f(dir/CMakeLists, std::ios::out|std::ios::trunc);
+        //installed modules are imported since CMake 3.28
+        if (modules) f << "cmake_minimum_required(VERSION 3.28)\n";
+        else f << CMAKE_HEADER "\n";
+        f << "project(" << name << "_package_test CXX)\n";
+        f << "set(CMAKE_CXX_STANDARD 20)\n";
+        f << "find_package(" << name << " REQUIRED CONFIG)\n";
+        f << "add_executable(" << name << "_package_test " << name << "_package_test.cpp)\n";
+        f << "target_link_libraries(" << name << "_package_test " << name << ")\n";
+    }
+    {
+        std::ofstream f(dir/(name+"_package_test.cpp"), std::ios::out|std::ios::trunc);
+        if (modules) f << "import " << name << ";\n\n";
+        else f << "#include <" << name << "/" << name << ".h>\n\n";
+        f << "int main() {\n    return 0;\n}\n";
+    }
+    std::ofstream f(src_tests/CMakeLists, std::ios::out|std::ios::app);
+    f << "\n# builds a project using the library installed as package\n";
+    f << "add_test(NAME \"tests/package\" COMMAND ${CMAKE_COMMAND} -D BINARY_DIR=${CMAKE_BINARY_DIR} -D CONFIG=$<CONFIG>\n";
+    f << "\t-D \"GENERATOR=${CMAKE_GENERATOR}\" -D CXX_COMPILER=${CMAKE_CXX_COMPILER} -P ${CMAKE_CURRENT_SOURCE_DIR}/package/package_test.cmake)\n";
+}
+
+static void install_test_harness() {
+    std::filesystem::path header = src_cxxtest/"cxxtest.h";
+    if (std::filesystem::exists(header)) return;
+    std::filesystem::create_directories(src_cxxtest);
+    std::ofstream f(header, std::ios::out|std::ios::trunc);
+    f << "#pragma once\n";
+    f << "#ifndef _CXXTEST_H_\n";
+    f << "#define _CXXTEST_H_\n";
+    f << "\n";
+    f << "// Minimal test registry, allows to compile all test files of a directory into one executable\n";
+    f << "//\n";
+    f << "// CXXTEST(name) {\n";
+    f << "//     CXXTEST_CHECK(1 + 1 == 2);\n";
+    f << "// }\n";
+    f << "//\n";
+    f << "// The function main() is in cxxtest_main.cpp\n";
+    f << "//\n";
+    f << "// Options:\n";
+    f << "//   --file <name>      run only tests of the source file (the name without directory)\n";
+    f << "//   --filter <text>    run only tests containing text in the name\n";
+    f << "//   --list             list tests\n";
+    f << "\n";
+    f << "#include <iostream>\n";
+    f << "#include <stdexcept>\n";
+    f << "#include <string>\n";
+    f << "#include <string_view>\n";
+    f << "#include <vector>\n";
+    f << "\n";
+    f << "namespace cxxtest {\n";
+    f << "\n";
+    f << "using Function = void (*)();\n";
+    f << "\n";
+    f << "struct Test {\n";
+    f << "    std::string name;\n";
+    f << "    std::string file;\n";
+    f << "    Function fn;\n";
+    f << "};\n";
+    f << "\n";
+    f << "inline std::vector<Test> &registry() {\n";
+    f << "    static std::vector<Test> r;\n";
+    f << "    return r;\n";
+    f << "}\n";
+    f << "\n";
+    f << "struct Registrar {\n";
+    f << "    Registrar(const char *name, std::string_view file, Function fn) {\n";
+    f << "        auto sep = file.find_last_of(\"/\\\\\");\n";
+    f << "        if (sep != file.npos) file = file.substr(sep + 1);\n";
+    f << "        registry().push_back({name, std::string(file), fn});\n";
+    f << "    }\n";
+    f << "};\n";
+    f << "\n";
+    f << "///Thrown by CXXTEST_CHECK\n";
+    f << "class Failure: public std::runtime_error {\n";
+    f << "public:\n";
+    f << "    using std::runtime_error::runtime_error;\n";
+    f << "};\n";
+    f << "\n";
+    f << "///Runs registered tests, returns exit code\n";
+    f << "inline int run(int argc, char **argv) {\n";
+    f << "    std::string_view file;\n";
+    f << "    std::string_view filter;\n";
+    f << "    bool list = false;\n";
+    f << "    for (int i = 1; i < argc; i++) {\n";
+    f << "        std::string_view a = argv[i];\n";
+    f << "        if (a == \"--file\" && i + 1 < argc) file = argv[++i];\n";
+    f << "        else if (a == \"--filter\" && i + 1 < argc) filter = argv[++i];\n";
+    f << "        else if (a == \"--list\") list = true;\n";
+    f << "        else {\n";
+    f << "            std::cerr << \"Unknown option: \" << a << \"\\n\"\n";
+    f << "                         \"Options: --file <name> --filter <text> --list\\n\";\n";
+    f << "            return 1;\n";
+    f << "        }\n";
+    f << "    }\n";
+    f << "    unsigned int count = 0;\n";
+    f << "    unsigned int failed = 0;\n";
+    f << "    for (const Test &t: registry()) {\n";
+    f << "        if (!file.empty() && t.file != file) continue;\n";
+    f << "        if (t.name.find(filter) == t.name.npos) continue;\n";
+    f << "        ++count;\n";
+    f << "        if (list) {\n";
+    f << "            std::cout << t.file << \": \" << t.name << \"\\n\";\n";
+    f << "            continue;\n";
+    f << "        }\n";
+    f << "        try {\n";
+    f << "            t.fn();\n";
+    f << "            std::cout << \"[  OK  ] \" << t.name << std::endl;\n";
+    f << "        } catch (const std::exception &e) {\n";
+    f << "            std::cout << \"[FAILED] \" << t.name << \": \" << e.what() << std::endl;\n";
+    f << "            ++failed;\n";
+    f << "        } catch (...) {\n";
+    f << "            std::cout << \"[FAILED] \" << t.name << \": unknown exception\" << std::endl;\n";
+    f << "            ++failed;\n";
+    f << "        }\n";
+    f << "    }\n";
+    f << "    if (!count) {\n";
+    f << "        std::cerr << \"No test matches the selection\" << std::endl;\n";
+    f << "        return 1;\n";
+    f << "    }\n";
+    f << "    return failed?1:0;\n";
+    f << "}\n";
+    f << "\n";
+    f << "}\n";
+    f << "\n";
+    f << "#define CXXTEST_STR2(x) #x\n";
+    f << "#define CXXTEST_STR(x) CXXTEST_STR2(x)\n";
+    f << "#define CXXTEST_CHECK(cond) \\\n";
+    f << "    do { if (!(cond)) throw ::cxxtest::Failure(__FILE__ \":\" CXXTEST_STR(__LINE__) \": \" #cond); } while (false)\n";
+    f << "\n";
+    f << "#define CXXTEST(name) \\\n";
+    f << "    static void cxxtest_fn_##name(); \\\n";
+    f << "    static ::cxxtest::Registrar cxxtest_reg_##name(#name, __FILE__, &cxxtest_fn_##name); \\\n";
+    f << "    static void cxxtest_fn_##name()\n";
+    f << "\n";
+    f << "#endif /* _CXXTEST_H_ */\n";
+    f.close();
+
+    std::ofstream m(src_cxxtest/"cxxtest_main.cpp", std::ios::out|std::ios::trunc);
+    m << "#include \"cxxtest.h\"\n\n";
+    m << "int main(int argc, char **argv) {\n    return cxxtest::run(argc, argv);\n}\n";
+}
+
+static void install_bench_harness() {
+    std::filesystem::path header = src_cxxbench/"cxxbench.h";
+    if (std::filesystem::exists(header)) return;
+    std::filesystem::create_directories(src_cxxbench);
+    std::ofstream f(header, std::ios::out|std::ios::trunc);
+    f << "#pragma once\n";
+    f << "#ifndef _CXXBENCH_H_\n";
+    f << "#define _CXXBENCH_H_\n";
+    f << "\n";
+    f << "// Minimal header-only microbenchmark harness\n";
+    f << "//\n";
+    f << "// CXXBENCH(name) {\n";
+    f << "//     ...setup...\n";
+    f << "//     for (auto _: state) {\n";
+    f << "//         ...measured code...\n";
+    f << "//     }\n";
+    f << "// }\n";
+    f << "//\n";
+    f << "// int main(int argc, char **argv) {\n";
+    f << "//     return cxxbench::run(argc, argv);\n";
+    f << "// }\n";
+    f << "//\n";
+    f << "// Options:\n";
+    f << "//   --filter <text>    run only benchmarks containing text in the name\n";
+    f << "//   --samples <n>      count of measured samples (default 30)\n";
+    f << "//   --min-time <ms>    minimal duration of one sample, used to calibrate iterations (default 5)\n";
+    f << "//   --warmup <ms>      duration of warmup before measurement (default 50)\n";
+    f << "//   --json <file>      where to write results (default log/<executable>.json)\n";
+    f << "//   --list             list benchmarks\n";
+    f << "\n";
+    f << "#include <algorithm>\n";
+    f << "#include <chrono>\n";
+    f << "#include <cmath>\n";
+    f << "#include <cstdint>\n";
+    f << "#include <cstdlib>\n";
+    f << "#include <filesystem>\n";
+    f << "#include <fstream>\n";
+    f << "#include <iomanip>\n";
+    f << "#include <iostream>\n";
+    f << "#include <sstream>\n";
+    f << "#include <stdexcept>\n";
+    f << "#include <string>\n";
+    f << "#include <string_view>\n";
+    f << "#include <vector>\n";
+    f << "\n";
+    f << "namespace cxxbench {\n";
+    f << "\n";
+    f << "///Prevents compiler to optimize out computation of the value\n";
+    f << "template<typename T>\n";
+    f << "inline void do_not_optimize(const T &value) {\n";
+    f << "#if defined(__GNUC__) || defined(__clang__)\n";
+    f << "    asm volatile(\"\" : : \"r,m\"(value) : \"memory\");\n";
+    f << "#else\n";
+    f << "    static const volatile void *sink;\n";
+    f << "    sink = &value;\n";
+    f << "#endif\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Prevents compiler to optimize out computation of the value\n";
+    f << "template<typename T>\n";
+    f << "inline void do_not_optimize(T &value) {\n";
+    f << "#if defined(__clang__)\n";
+    f << "    asm volatile(\"\" : \"+r,m\"(value) : : \"memory\");\n";
+    f << "#elif defined(__GNUC__)\n";
+    f << "    asm volatile(\"\" : \"+m,r\"(value) : : \"memory\");\n";
+    f << "#else\n";
+    f << "    static volatile void *sink;\n";
+    f << "    sink = &value;\n";
+    f << "#endif\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Forces all pending writes to memory\n";
+    f << "inline void clobber_memory() {\n";
+    f << "#if defined(__GNUC__) || defined(__clang__)\n";
+    f << "    asm volatile(\"\" : : : \"memory\");\n";
+    f << "#endif\n";
+    f << "}\n";
+    f << "\n";
+    f << "///State of the benchmark, iterate it by range-for to repeat measured code\n";
+    f << "class State {\n";
+    f << "public:\n";
+    f << "    struct [[maybe_unused]] Value {};\n";
+    f << "\n";
+    f << "    class Iterator {\n";
+    f << "    public:\n";
+    f << "        explicit Iterator(std::uint64_t remain):_remain(remain) {}\n";
+    f << "        bool operator!=(const Iterator &) const {return _remain != 0;}\n";
+    f << "        Iterator &operator++() {--_remain; return *this;}\n";
+    f << "        Value operator*() const {return {};}\n";
+    f << "    protected:\n";
+    f << "        std::uint64_t _remain;\n";
+    f << "    };\n";
+    f << "\n";
+    f << "    explicit State(std::uint64_t iterations):_iterations(iterations) {}\n";
+    f << "    Iterator begin() const {return Iterator(_iterations);}\n";
+    f << "    Iterator end() const {return Iterator(0);}\n";
+    f << "    std::uint64_t iterations() const {return _iterations;}\n";
+    f << "\n";
+    f << "protected:\n";
+    f << "    std::uint64_t _iterations;\n";
+    f << "};\n";
+    f << "\n";
+    f << "using Function = void (*)(State &);\n";
+    f << "\n";
+    f << "struct Benchmark {\n";
+    f << "    std::string name;\n";
+    f << "    Function fn;\n";
+    f << "};\n";
+    f << "\n";
+    f << "inline std::vector<Benchmark> &registry() {\n";
+    f << "    static std::vector<Benchmark> r;\n";
+    f << "    return r;\n";
+    f << "}\n";
+    f << "\n";
+    f << "struct Registrar {\n";
+    f << "    Registrar(const char *name, Function fn) {\n";
+    f << "        registry().push_back({name, fn});\n";
+    f << "    }\n";
+    f << "};\n";
+    f << "\n";
+    f << "struct Options {\n";
+    f << "    std::string filter;\n";
+    f << "    unsigned int samples = 30;\n";
+    f << "    double min_time_ms = 5;\n";
+    f << "    double warmup_ms = 50;\n";
+    f << "    std::string json;\n";
+    f << "    bool list = false;\n";
+    f << "};\n";
+    f << "\n";
+    f << "struct Result {\n";
+    f << "    std::string name;\n";
+    f << "    std::uint64_t iterations = 0;\n";
+    f << "    ///time of one iteration of each sample in nanoseconds\n";
+    f << "    std::vector<double> samples;\n";
+    f << "    double min = 0;\n";
+    f << "    double median = 0;\n";
+    f << "    double p99 = 0;\n";
+    f << "    double mean = 0;\n";
+    f << "};\n";
+    f << "\n";
+    f << "///Measures one batch, returns duration in nanoseconds\n";
+    f << "inline double run_batch(Function fn, std::uint64_t iterations) {\n";
+    f << "    State state(iterations);\n";
+    f << "    auto start = std::chrono::steady_clock::now();\n";
+    f << "    fn(state);\n";
+    f << "    auto end = std::chrono::steady_clock::now();\n";
+    f << "    return std::chrono::duration<double, std::nano>(end - start).count();\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Finds count of iterations of one sample, which takes at least min_time\n";
+    f << "inline std::uint64_t calibrate(Function fn, double min_time_ns) {\n";
+    f << "    std::uint64_t n = 1;\n";
+    f << "    while (true) {\n";
+    f << "        double t = run_batch(fn, n);\n";
+    f << "        if (t >= min_time_ns || n >= (std::uint64_t(1) << 40)) return n;\n";
+    f << "        if (t < min_time_ns / 10) {\n";
+    f << "            n *= 10;\n";
+    f << "        } else {\n";
+    f << "            n = static_cast<std::uint64_t>(n * (min_time_ns / t) * 1.2) + 1;\n";
+    f << "        }\n";
+    f << "    }\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Returns value at percentile (0-1) of sorted samples (nearest rank)\n";
+    f << "inline double percentile(const std::vector<double> &sorted, double p) {\n";
+    f << "    std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));\n";
+    f << "    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline Result measure(const Benchmark &b, const Options &opts) {\n";
+    f << "    Result r;\n";
+    f << "    r.name = b.name;\n";
+    f << "    //caches and CPU frequency settle before the iterations are calibrated\n";
+    f << "    auto warmup_end = std::chrono::steady_clock::now()\n";
+    f << "                    + std::chrono::duration<double, std::milli>(opts.warmup_ms);\n";
+    f << "    for (std::uint64_t n = 1; std::chrono::steady_clock::now() < warmup_end; n = std::min<std::uint64_t>(n * 2, 1 << 20)) {\n";
+    f << "        run_batch(b.fn, n);\n";
+    f << "    }\n";
+    f << "    r.iterations = calibrate(b.fn, opts.min_time_ms * 1e6);\n";
+    f << "    for (unsigned int i = 0; i < opts.samples; i++) {\n";
+    f << "        r.samples.push_back(run_batch(b.fn, r.iterations) / r.iterations);\n";
+    f << "    }\n";
+    f << "    std::vector<double> sorted = r.samples;\n";
+    f << "    std::sort(sorted.begin(), sorted.end());\n";
+    f << "    r.min = sorted.front();\n";
+    f << "    r.median = percentile(sorted, 0.5);\n";
+    f << "    r.p99 = percentile(sorted, 0.99);\n";
+    f << "    double sum = 0;\n";
+    f << "    for (double v: sorted) sum += v;\n";
+    f << "    r.mean = sum / sorted.size();\n";
+    f << "    return r;\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline std::string format_time(double ns) {\n";
+    f << "    std::ostringstream s;\n";
+    f << "    s << std::fixed << std::setprecision(2);\n";
+    f << "    if (ns < 1e3) s << ns << \" ns\";\n";
+    f << "    else if (ns < 1e6) s << ns / 1e3 << \" us\";\n";
+    f << "    else if (ns < 1e9) s << ns / 1e6 << \" ms\";\n";
+    f << "    else s << ns / 1e9 << \" s\";\n";
+    f << "    return s.str();\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline std::string json_string(std::string_view str) {\n";
+    f << "    std::string out = \"\\\"\";\n";
+    f << "    for (char c: str) {\n";
+    f << "        if (c == '\"' || c == '\\\\') out.push_back('\\\\');\n";
+    f << "        out.push_back(c);\n";
+    f << "    }\n";
+    f << "    out.push_back('\"');\n";
+    f << "    return out;\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline void write_json(std::ostream &out, std::string_view executable, const std::vector<Result> &results) {\n";
+    f << "    out << std::setprecision(17);\n";
+    f << "    out << \"{\\n  \\\"executable\\\": \" << json_string(executable) << \",\\n  \\\"benchmarks\\\": [\";\n";
+    f << "    const char *sep = \"\\n\";\n";
+    f << "    for (const Result &r: results) {\n";
+    f << "        out << sep << \"    {\\\"name\\\": \" << json_string(r.name)\n";
+    f << "            << \", \\\"iterations\\\": \" << r.iterations\n";
+    f << "            << \", \\\"min_ns\\\": \" << r.min\n";
+    f << "            << \", \\\"median_ns\\\": \" << r.median\n";
+    f << "            << \", \\\"p99_ns\\\": \" << r.p99\n";
+    f << "            << \", \\\"mean_ns\\\": \" << r.mean\n";
+    f << "            << \", \\\"samples_ns\\\": [\";\n";
+    f << "        const char *vsep = \"\";\n";
+    f << "        for (double v: r.samples) {\n";
+    f << "            out << vsep << v;\n";
+    f << "            vsep = \", \";\n";
+    f << "        }\n";
+    f << "        out << \"]}\";\n";
+    f << "        sep = \",\\n\";\n";
+    f << "    }\n";
+    f << "    out << \"\\n  ]\\n}\\n\";\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline bool parse_options(int argc, char **argv, Options &opts) {\n";
+    f << "    for (int i = 1; i < argc; i++) {\n";
+    f << "        std::string_view a = argv[i];\n";
+    f << "        auto value = [&]() -> std::string_view {\n";
+    f << "            if (i + 1 >= argc) throw std::invalid_argument(std::string(a));\n";
+    f << "            return argv[++i];\n";
+    f << "        };\n";
+    f << "        if (a == \"--filter\") opts.filter = value();\n";
+    f << "        else if (a == \"--samples\") opts.samples = std::max(1, std::atoi(value().data()));\n";
+    f << "        else if (a == \"--min-time\") opts.min_time_ms = std::atof(value().data());\n";
+    f << "        else if (a == \"--warmup\") opts.warmup_ms = std::atof(value().data());\n";
+    f << "        else if (a == \"--json\") opts.json = value();\n";
+    f << "        else if (a == \"--list\") opts.list = true;\n";
+    f << "        else {\n";
+    f << "            std::cerr << \"Unknown option: \" << a << \"\\n\"\n";
+    f << "                         \"Options: --filter <text> --samples <n> --min-time <ms> --warmup <ms> --json <file> --list\\n\";\n";
+    f << "            return false;\n";
+    f << "        }\n";
+    f << "    }\n";
+    f << "    return true;\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Runs all registered benchmarks, returns exit code\n";
+    f << "inline int run(int argc, char **argv) {\n";
+    f << "    Options opts;\n";
+    f << "    try {\n";
+    f << "        if (!parse_options(argc, argv, opts)) return 1;\n";
+    f << "    } catch (const std::invalid_argument &e) {\n";
+    f << "        std::cerr << \"Missing value of option: \" << e.what() << std::endl;\n";
+    f << "        return 1;\n";
+    f << "    }\n";
+    f << "    std::string executable = argc > 0?std::filesystem::path(argv[0]).filename().string():\"benchmark\";\n";
+    f << "    if (opts.list) {\n";
+    f << "        for (const Benchmark &b: registry()) std::cout << b.name << \"\\n\";\n";
+    f << "        return 0;\n";
+    f << "    }\n";
+    f << "#ifndef NDEBUG\n";
+    f << "    std::cerr << \"Warning: benchmark is not compiled in release mode, results are not representative\" << std::endl;\n";
+    f << "#endif\n";
+    f << "    std::cout << std::left << std::setw(32) << \"Benchmark\" << std::right\n";
+    f << "              << std::setw(14) << \"Iterations\" << std::setw(14) << \"Min\"\n";
+    f << "              << std::setw(14) << \"Median\" << std::setw(14) << \"P99\" << std::endl;\n";
+    f << "    std::vector<Result> results;\n";
+    f << "    for (const Benchmark &b: registry()) {\n";
+    f << "        if (b.name.find(opts.filter) == b.name.npos) continue;\n";
+    f << "        Result r = measure(b, opts);\n";
+    f << "        std::cout << std::left << std::setw(32) << r.name << std::right\n";
+    f << "                  << std::setw(14) << r.iterations << std::setw(14) << format_time(r.min)\n";
+    f << "                  << std::setw(14) << format_time(r.median) << std::setw(14) << format_time(r.p99) << std::endl;\n";
+    f << "        results.push_back(std::move(r));\n";
+    f << "    }\n";
+    f << "    std::filesystem::path json = opts.json.empty()?std::filesystem::path(\"log\")/(executable+\".json\"):std::filesystem::path(opts.json);\n";
+    f << "    if (json.has_parent_path()) std::filesystem::create_directories(json.parent_path());\n";
+    f << "    std::ofstream out(json, std::ios::out|std::ios::trunc);\n";
+    f << "    if (!out) {\n";
+    f << "        std::cerr << \"Failed to write: \" << json << std::endl;\n";
+    f << "        return 1;\n";
+    f << "    }\n";
+    f << "    write_json(out, executable, results);\n";
+    f << "    return 0;\n";
+    f << "}\n";
+    f << "\n";
+    f << "}\n";
+    f << "\n";
+    f << "#define CXXBENCH(name) \\\n";
+    f << "    static void cxxbench_fn_##name(::cxxbench::State &state); \\\n";
+    f << "    static ::cxxbench::Registrar cxxbench_reg_##name(#name, &cxxbench_fn_##name); \\\n";
+    f << "    static void cxxbench_fn_##name([[maybe_unused]] ::cxxbench::State &state)\n";
+    f << "\n";
+    f << "#endif /* _CXXBENCH_H_ */\n";
+}
+
+///Vendors the header-only tracing library into src/cxxtrace
+static void install_tracing_library() {
+    std::filesystem::path header = src_cxxtrace/"cxxtrace.h";
+    if (std::filesystem::exists(header)) return;
+    std::filesystem::create_directories(src_cxxtrace);
+    std::ofstream f(header, std::ios::out|std::ios::trunc);
+    f << "#pragma once\n";
+    f << "#ifndef _CXXTRACE_H_\n";
+    f << "#define _CXXTRACE_H_\n";
+    f << "\n";
+    f << "// Low overhead tracing of spans into Chrome trace event JSON (open it in ui.perfetto.dev or chrome://tracing)\n";
+    f << "//\n";
+    f << "// void handle(Request &req) {\n";
+    f << "//     CXXTRACE_SCOPE(\"handle\");             // span covers the rest of the block\n";
+    f << "//     ...\n";
+    f << "//     {\n";
+    f << "//         CXXTRACE_SCOPE_CAT(\"db\", \"query\");\n";
+    f << "//         ...\n";
+    f << "//     }\n";
+    f << "//     CXXTRACE_INSTANT(\"cache miss\");\n";
+    f << "// }\n";
+    f << "//\n";
+    f << "// CXXTRACE_FUNCTION()            span named by the enclosing function\n";
+    f << "// CXXTRACE_THREAD_NAME(\"worker\") name of the current thread in the trace\n";
+    f << "//\n";
+    f << "// Names and categories must be string literals (only pointers are recorded). Each thread records events into\n";
+    f << "// its own fixed-size ring buffer without locks and allocation, a background thread flushes the buffers every\n";
+    f << "// 100 ms into log/trace-<pid>.json (or the file in CXXTRACE_OUTPUT). Events are dropped (and counted) when\n";
+    f << "// a buffer is full. Tracing is compiled in when CXXTRACE_ENABLED is defined - in debug builds and in release\n";
+    f << "// builds with -DTRACING=ON in the build profile. Otherwise the macros expand to nothing.\n";
+    f << "\n";
+    f << "#ifdef CXXTRACE_ENABLED\n";
+    f << "\n";
+    f << "#include <algorithm>\n";
+    f << "#include <atomic>\n";
+    f << "#include <chrono>\n";
+    f << "#include <condition_variable>\n";
+    f << "#include <cstdint>\n";
+    f << "#include <cstdlib>\n";
+    f << "#include <filesystem>\n";
+    f << "#include <fstream>\n";
+    f << "#include <memory>\n";
+    f << "#include <mutex>\n";
+    f << "#include <string>\n";
+    f << "#include <thread>\n";
+    f << "#include <vector>\n";
+    f << "#include <unistd.h>\n";
+    f << "\n";
+    f << "namespace cxxtrace {\n";
+    f << "\n";
+    f << "struct Event {\n";
+    f << "    const char *name;\n";
+    f << "    const char *category;\n";
+    f << "    std::int64_t start_ns;\n";
+    f << "    ///Duration of the span, negative for instant events\n";
+    f << "    std::int64_t duration_ns;\n";
+    f << "};\n";
+    f << "\n";
+    f << "inline std::int64_t now_ns() {\n";
+    f << "    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Ring buffer of one thread, written only by the thread and read only by the flusher\n";
+    f << "class Buffer {\n";
+    f << "public:\n";
+    f << "    static constexpr std::uint64_t capacity = 1 << 14;\n";
+    f << "\n";
+    f << "    explicit Buffer(std::uint32_t tid):tid(tid) {}\n";
+    f << "\n";
+    f << "    void push(const Event &e) {\n";
+    f << "        std::uint64_t h = _head.load(std::memory_order_relaxed);\n";
+    f << "        if (h - _tail.load(std::memory_order_acquire) >= capacity) {\n";
+    f << "            dropped.fetch_add(1, std::memory_order_relaxed);\n";
+    f << "            return;\n";
+    f << "        }\n";
+    f << "        _events[h & (capacity - 1)] = e;\n";
+    f << "        _head.store(h + 1, std::memory_order_release);\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    ///Passes all recorded events to fn, called by the flusher\n";
+    f << "    template<typename Fn>\n";
+    f << "    void drain(Fn &&fn) {\n";
+    f << "        std::uint64_t t = _tail.load(std::memory_order_relaxed);\n";
+    f << "        std::uint64_t h = _head.load(std::memory_order_acquire);\n";
+    f << "        for (; t != h; ++t) fn(_events[t & (capacity - 1)]);\n";
+    f << "        _tail.store(h, std::memory_order_release);\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    const std::uint32_t tid;\n";
+    f << "    std::atomic<const char *> thread_name{nullptr};\n";
+    f << "    ///Name of the thread is written to the trace, used only by the flusher\n";
+    f << "    bool named = false;\n";
+    f << "    std::atomic<std::uint64_t> dropped{0};\n";
+    f << "    ///Thread exited, the buffer is removed after the next flush\n";
+    f << "    std::atomic<bool> finished{false};\n";
+    f << "\n";
+    f << "protected:\n";
+    f << "    Event _events[capacity];\n";
+    f << "    std::atomic<std::uint64_t> _head{0};\n";
+    f << "    std::atomic<std::uint64_t> _tail{0};\n";
+    f << "};\n";
+    f << "\n";
+    f << "///Collects buffers of all threads and writes them by a background thread\n";
+    f << "class Tracer {\n";
+    f << "public:\n";
+    f << "    Tracer() {\n";
+    f << "        const char *env = std::getenv(\"CXXTRACE_OUTPUT\");\n";
+    f << "        std::filesystem::path file = env && *env?std::filesystem::path(env)\n";
+    f << "                                   :std::filesystem::path(\"log\")/(\"trace-\"+std::to_string(getpid())+\".json\");\n";
+    f << "        std::error_code ec;\n";
+    f << "        if (file.has_parent_path()) std::filesystem::create_directories(file.parent_path(), ec);\n";
+    f << "        _out.open(file, std::ios::out|std::ios::trunc);\n";
+    f << "        //trailing ] is optional in the JSON array format, so the trace of a crashed program is still readable\n";
+    f << "        _out << \"[\";\n";
+    f << "        _flusher = std::thread([this]{run();});\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    ~Tracer() {\n";
+    f << "        {\n";
+    f << "            std::lock_guard<std::mutex> lock(_mutex);\n";
+    f << "            _stop = true;\n";
+    f << "        }\n";
+    f << "        _wake.notify_one();\n";
+    f << "        _flusher.join();\n";
+    f << "        flush();\n";
+    f << "        _out << \"\\n]\\n\";\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    std::shared_ptr<Buffer> add_thread() {\n";
+    f << "        std::lock_guard<std::mutex> lock(_mutex);\n";
+    f << "        auto b = std::make_shared<Buffer>(++_threads);\n";
+    f << "        _buffers.push_back(b);\n";
+    f << "        return b;\n";
+    f << "    }\n";
+    f << "\n";
+    f << "protected:\n";
+    f << "    void run() {\n";
+    f << "        std::unique_lock<std::mutex> lock(_mutex);\n";
+    f << "        while (!_stop) {\n";
+    f << "            _wake.wait_for(lock, std::chrono::milliseconds(100));\n";
+    f << "            lock.unlock();\n";
+    f << "            flush();\n";
+    f << "            lock.lock();\n";
+    f << "        }\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    void flush() {\n";
+    f << "        std::vector<std::shared_ptr<Buffer> > buffers;\n";
+    f << "        {\n";
+    f << "            std::lock_guard<std::mutex> lock(_mutex);\n";
+    f << "            buffers = _buffers;\n";
+    f << "        }\n";
+    f << "        for (const auto &b: buffers) {\n";
+    f << "            bool finished = b->finished.load(std::memory_order_acquire);\n";
+    f << "            const char *name = b->thread_name.load(std::memory_order_relaxed);\n";
+    f << "            if (name && !b->named) {\n";
+    f << "                begin_event() << \"{\\\"name\\\":\\\"thread_name\\\",\\\"ph\\\":\\\"M\\\",\\\"pid\\\":\" << _pid << \",\\\"tid\\\":\" << b->tid\n";
+    f << "                              << \",\\\"args\\\":{\\\"name\\\":\" << quoted(name) << \"}}\";\n";
+    f << "                b->named = true;\n";
+    f << "            }\n";
+    f << "            b->drain([&](const Event &e){write(*b, e);});\n";
+    f << "            std::uint64_t dropped = b->dropped.exchange(0, std::memory_order_relaxed);\n";
+    f << "            if (dropped) {\n";
+    f << "                begin_event() << \"{\\\"name\\\":\\\"cxxtrace: \" << dropped << \" events dropped\\\",\\\"ph\\\":\\\"i\\\",\\\"s\\\":\\\"t\\\",\\\"ts\\\":\"\n";
+    f << "                              << micros(now_ns()) << \",\\\"pid\\\":\" << _pid << \",\\\"tid\\\":\" << b->tid << \"}\";\n";
+    f << "            }\n";
+    f << "            if (finished) {\n";
+    f << "                std::lock_guard<std::mutex> lock(_mutex);\n";
+    f << "                _buffers.erase(std::find(_buffers.begin(), _buffers.end(), b));\n";
+    f << "            }\n";
+    f << "        }\n";
+    f << "        _out.flush();\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    void write(const Buffer &b, const Event &e) {\n";
+    f << "        std::ostream &out = begin_event();\n";
+    f << "        out << \"{\\\"name\\\":\" << quoted(e.name) << \",\\\"cat\\\":\" << quoted(e.category);\n";
+    f << "        if (e.duration_ns < 0) out << \",\\\"ph\\\":\\\"i\\\",\\\"s\\\":\\\"t\\\"\";\n";
+    f << "        else out << \",\\\"ph\\\":\\\"X\\\",\\\"dur\\\":\" << micros(e.duration_ns);\n";
+    f << "        out << \",\\\"ts\\\":\" << micros(e.start_ns) << \",\\\"pid\\\":\" << _pid << \",\\\"tid\\\":\" << b.tid << \"}\";\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    std::ostream &begin_event() {\n";
+    f << "        _out << (_first?\"\\n\":\",\\n\");\n";
+    f << "        _first = false;\n";
+    f << "        return _out;\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    static std::string micros(std::int64_t ns) {\n";
+    f << "        std::string s = std::to_string(ns / 1000) + \".000\";\n";
+    f << "        std::int64_t frac = ns % 1000;\n";
+    f << "        for (int i = 0; i < 3; i++, frac /= 10) s[s.size() - 1 - i] = static_cast<char>('0' + frac % 10);\n";
+    f << "        return s;\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    static std::string quoted(const char *str) {\n";
+    f << "        std::string out = \"\\\"\";\n";
+    f << "        for (; *str; ++str) {\n";
+    f << "            if (*str == '\"' || *str == '\\\\') out.push_back('\\\\');\n";
+    f << "            if (static_cast<unsigned char>(*str) >= 0x20) out.push_back(*str);\n";
+    f << "        }\n";
+    f << "        out.push_back('\"');\n";
+    f << "        return out;\n";
+    f << "    }\n";
+    f << "\n";
+    f << "    const int _pid = getpid();\n";
+    f << "    std::ofstream _out;\n";
+    f << "    bool _first = true;\n";
+    f << "    std::mutex _mutex;\n";
+    f << "    std::condition_variable _wake;\n";
+    f << "    bool _stop = false;\n";
+    f << "    std::uint32_t _threads = 0;\n";
+    f << "    std::vector<std::shared_ptr<Buffer> > _buffers;\n";
+    f << "    std::thread _flusher;\n";
+    f << "};\n";
+    f << "\n";
+    f << "inline Tracer &tracer() {\n";
+    f << "    static Tracer t;\n";
+    f << "    return t;\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Buffer of the current thread, registered on the first event of the thread\n";
+    f << "class ThreadBuffer {\n";
+    f << "public:\n";
+    f << "    ThreadBuffer():_buffer(tracer().add_thread()) {}\n";
+    f << "    ~ThreadBuffer() {_buffer->finished.store(true, std::memory_order_release);}\n";
+    f << "    Buffer &operator*() const {return *_buffer;}\n";
+    f << "\n";
+    f << "protected:\n";
+    f << "    std::shared_ptr<Buffer> _buffer;\n";
+    f << "};\n";
+    f << "\n";
+    f << "inline Buffer &thread_buffer() {\n";
+    f << "    thread_local ThreadBuffer b;\n";
+    f << "    return *b;\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline void instant(const char *name, const char *category) {\n";
+    f << "    thread_buffer().push({name, category, now_ns(), -1});\n";
+    f << "}\n";
+    f << "\n";
+    f << "inline void thread_name(const char *name) {\n";
+    f << "    thread_buffer().thread_name.store(name, std::memory_order_relaxed);\n";
+    f << "}\n";
+    f << "\n";
+    f << "///Records the span from its construction to its destruction\n";
+    f << "class Span {\n";
+    f << "public:\n";
+    f << "    Span(const char *name, const char *category):_name(name), _category(category), _start(now_ns()) {}\n";
+    f << "    ~Span() {\n";
+    f << "        std::int64_t end = now_ns();\n";
+    f << "        thread_buffer().push({_name, _category, _start, end - _start});\n";
+    f << "    }\n";
+    f << "    Span(const Span &) = delete;\n";
+    f << "    Span &operator=(const Span &) = delete;\n";
+    f << "\n";
+    f << "protected:\n";
+    f << "    const char *_name;\n";
+    f << "    const char *_category;\n";
+    f << "    std::int64_t _start;\n";
+    f << "};\n";
+    f << "\n";
+    f << "}\n";
+    f << "\n";
+    f << "#define CXXTRACE_CONCAT2(a, b) a##b\n";
+    f << "#define CXXTRACE_CONCAT(a, b) CXXTRACE_CONCAT2(a, b)\n";
+    f << "#define CXXTRACE_SCOPE_CAT(category, name) ::cxxtrace::Span CXXTRACE_CONCAT(cxxtrace_span_, __LINE__)(name, category)\n";
+    f << "#define CXXTRACE_SCOPE(name) CXXTRACE_SCOPE_CAT(\"default\", name)\n";
+    f << "#define CXXTRACE_FUNCTION() CXXTRACE_SCOPE(__func__)\n";
+    f << "#define CXXTRACE_INSTANT(name) ::cxxtrace::instant(name, \"default\")\n";
+    f << "#define CXXTRACE_THREAD_NAME(name) ::cxxtrace::thread_name(name)\n";
+    f << "\n";
+    f << "#else\n";
+    f << "\n";
+    f << "#define CXXTRACE_SCOPE_CAT(category, name) static_cast<void>(0)\n";
+    f << "#define CXXTRACE_SCOPE(name) static_cast<void>(0)\n";
+    f << "#define CXXTRACE_FUNCTION() static_cast<void>(0)\n";
+    f << "#define CXXTRACE_INSTANT(name) static_cast<void>(0)\n";
+    f << "#define CXXTRACE_THREAD_NAME(name) static_cast<void>(0)\n";
+    f << "\n";
+    f << "#endif\n";
+    f << "\n";
+    f << "#endif /* _CXXTRACE_H_ */\n";
+    f.close();
+
+    std::ofstream m(src_cxxtrace/CMakeLists, std::ios::out|std::ios::trunc);
+    m << CMAKE_HEADER "\n";
+    m << "# Tracing is compiled into debug builds, release builds enable it by -DTRACING=ON in the build profile\n";
+    m << "set(TRACING OFF CACHE BOOL \"Tracing of spans (CXXTRACE_*) in release builds\")\n";
+    m << "find_package(Threads REQUIRED)\n";
+    m << "\n";
+    m << "add_library(cxxtrace INTERFACE)\n";
+    m << "target_include_directories(cxxtrace INTERFACE ${CMAKE_CURRENT_SOURCE_DIR}/..)\n";
+    m << "target_link_libraries(cxxtrace INTERFACE Threads::Threads)\n";
+    m << "if(TRACING)\n";
+    m << "\ttarget_compile_definitions(cxxtrace INTERFACE CXXTRACE_ENABLED)\n";
+    m << "else()\n";
+    m << "\ttarget_compile_definitions(cxxtrace INTERFACE $<$<CONFIG:Debug>:CXXTRACE_ENABLED>)\n";
+    m << "endif()\n";
+}
+
+static void create_bench_source(std::string bench_dir) {
+    std::filesystem::path source = src/bench_dir/bench_dir;
+    source.replace_extension("cpp");
+    if (!std::filesystem::exists(source)) {
+        std::ofstream x(source, std::ios::out);
+        x << "#include <cxxbench/cxxbench.h>\n\n";
+        x << "#include <numeric>\n#include <vector>\n\n";
+        x << "CXXBENCH(accumulate) {\n"
+             "    std::vector<int> data(1000, 1);\n"
+             "    for (auto _: state) {\n"
+             "        int sum = std::accumulate(data.begin(), data.end(), 0);\n"
+             "        cxxbench::do_not_optimize(sum);\n"
+             "    }\n"
+             "}\n\n";
+        x << "int main(int argc, char **argv) {\n    return cxxbench::run(argc, argv);\n}\n";
+    }
+}
+
+static void create_bench_cmake(std::string bench_dir) {
+    std::string sublists = src/bench_dir/CMakeLists;
+    std::ofstream f(sublists, std::ios::out| std::ios::trunc);
+    if (!f) {
+        int e = errno;
+        throw std::system_error(e, std::system_category(), "Failed to open "+sublists);
+    }
+    f << CMAKE_HEADER "\n";
+    f << "if(NOT DEFINED OUTPUT_DIR)\n"
+         "\tset(OUTPUT_DIR ${CMAKE_BINARY_DIR})\n"
+         "endif()\n"
+         "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${OUTPUT_DIR}/bench/)\n"
+         "set(benchFiles \n"
+         "\t" << bench_dir << ".cpp\n"
+         ")\n\n"
+
+         "if(NOT TARGET bench)\n"
+            "\tadd_custom_target(bench)\n"
+         "endif()\n\n"
 
+        "foreach (benchFile ${benchFiles})\n"
+            "\tstring(REGEX MATCH \"([^\\/]+$)\" filename ${benchFile})\n"
+            "\tstring(REGEX MATCH \"[^.]*\" executable_name " << bench_dir << "_${filename})\n"
+            "\tadd_executable(${executable_name} ${benchFile})\n"
+            "\ttarget_link_libraries(${executable_name} ${STANDARD_LIBRARIES} )\n"
+            //runs from the build directory, so results are written to its log/
+            "\tadd_custom_target(run_${executable_name} COMMAND ${executable_name} WORKING_DIRECTORY ${OUTPUT_DIR} USES_TERMINAL)\n"
+            "\tadd_dependencies(bench run_${executable_name})\n"
+        "endforeach ()\n";
 }
 
-static void create_library_dot_cmake(std::string name) {
+static void create_library_dot_cmake(std::string name, LibraryKind kind) {
     std::ofstream f("library.cmake", std::ios::out| std::ios::trunc);
     if (!f) {
         int e = errno;
         throw std::system_error(e, std::system_category(), "Failed to open library.cmake");
     }
+    //the library can be included by more libraries of a project
+    f << "if (TARGET " << name << ")\n";
+    f << "\treturn()\n";
+    f << "endif()\n";
     f << "include_directories(AFTER ${CMAKE_CURRENT_LIST_DIR}/src)\n";
-    f << "add_subdirectory (${CMAKE_CURRENT_LIST_DIR}/src/" << name << " EXCLUDE_FROM_ALL)\n";
+    if (kind != LibraryKind::interface) {
+        //the project importing the library from sources builds its version as well
+        f << "if (NOT TARGET " << name << "_version)\n";
+        f << "\tadd_subdirectory(${CMAKE_CURRENT_LIST_DIR}/version ${CMAKE_BINARY_DIR}/" << name << "_version)\n";
+        f << "endif()\n";
+    }
+    switch (kind) {
+        case LibraryKind::interface:
+            //header-only library doesn't need its directory
+            f << "add_library(" << name << " INTERFACE)\n";
+            f << "target_include_directories(" << name << " INTERFACE $<BUILD_INTERFACE:${CMAKE_CURRENT_LIST_DIR}/src>)\n";
+            //the library project installs the library
+            f << "if (CMAKE_CURRENT_LIST_DIR STREQUAL CMAKE_SOURCE_DIR)\n";
+            f << "\tadd_subdirectory (${CMAKE_CURRENT_LIST_DIR}/src/" << name << ")\n";
+            f << "endif()\n";
+            break;
+        case LibraryKind::shared:
+            //the shared library is needed at runtime, so it is built and installed with the project
+            f << "add_subdirectory (${CMAKE_CURRENT_LIST_DIR}/src/" << name << ")\n";
+            break;
+        default:
+            //the library project itself builds and installs the library
+            f << "if (CMAKE_CURRENT_LIST_DIR STREQUAL CMAKE_SOURCE_DIR)\n";
+            f << "\tadd_subdirectory (${CMAKE_CURRENT_LIST_DIR}/src/" << name << ")\n";
+            f << "else()\n";
+            f << "\tadd_subdirectory (${CMAKE_CURRENT_LIST_DIR}/src/" << name << " EXCLUDE_FROM_ALL)\n";
+            f << "endif()\n";
+            break;
+    }
 }
 
-static int create_exec(std::string name) {
+static int create_exec(std::string name, Generator gen, const TargetOptions &opts) {
 
     if (name == "tests") throw std::runtime_error("Name 'tests' cannot be used");
 
 
-    create_project_skeleton(name, [=](std::ostream &out){
+    create_project_skeleton(name, gen, [=](std::ostream &out){
 
         out << "include_directories(AFTER src)\n";
+        if (opts.tracing) {
+            out << "add_subdirectory(\"src/cxxtrace\")\n";
+            install_tracing_library();
+        }
         out << "add_subdirectory(\"src/" << name << "\")\n";
 
         version_build_files(name);
-        create_main_source(name, true, true);
+        create_main_source(name, true, true, opts.tracing);
         create_main_header(name, true);
-        create_exec_cmake(name, true);
+        create_exec_cmake(name, true, opts);
 
 
     });
     return 0;
 }
 
-static int create_lib(std::string name) {
+///Modules are supported only by the Ninja generator and they can't be header-only
+static void check_modules(const TargetOptions &opts, Generator gen) {
+    if (!opts.modules) return;
+    if (opts.kind == LibraryKind::interface) {
+        throw std::runtime_error("Interface library cannot be created with --modules");
+    }
+    if (gen != Generator::ninja) {
+        throw std::runtime_error("C++ modules require the Ninja generator (use --generator ninja, "
+                                 "or 'cxxproject update makefile --generator ninja' for an existing project)");
+    }
+}
+
+static int create_lib(std::string name, Generator gen, const TargetOptions &opts) {
 
     if (name == "tests") throw std::runtime_error("Name 'tests' cannot be used");
+    check_modules(opts, gen);
 
-    create_project_skeleton(name, [=](std::ostream &out){
+    create_project_skeleton(name, gen, [=](std::ostream &out){
 
+        if (opts.modules) {
+            out << "include(cmake/CxxModules.cmake)\n";
+            install_cxx_modules_module();
+        }
         out << "include(library.cmake)\n";
         out << "enable_testing()\n";
         out << "add_subdirectory(\"src/tests\")\n";
 
         version_build_files(name);
         create_directories(src_tests);
-        create_main_source(name, false, true);
-        create_main_header(name, false);
-        create_test_source(name, "tests");
-        create_test_cmake(name, "tests");
-        create_library_dot_cmake(name);
-        create_lib_cmake(name,true);
+        if (opts.modules) {
+            create_module_sources(name, opts.kind);
+        } else {
+            if (opts.kind != LibraryKind::interface) create_main_source(name, false, true);
+            create_main_header(name, false, opts.kind);
+        }
+        if (opts.single_binary) install_test_harness();
+        create_test_source(name, "tests", opts.single_binary, opts.modules);
+        create_test_cmake(name, "tests", opts.single_binary);
+        create_package_test(name, opts.modules);
+        create_library_dot_cmake(name, opts.kind);
+        create_lib_cmake(name,true, opts);
 
 
     });
-    SYSTEM("git add library.cmake");
 
 
     return 0;
 
 }
 
-template<typename Fn>
-static void insert_to_cmake(Fn &&fn) {
-    std::string fname = CMakeLists;
-    std::string fname_new = fname+".part";
-    std::string ln;
+///Changes of the project made by a command, which are written and staged at once by commit_batch()
+struct Batch {
+    ///Lines of the root CMakeLists.txt, read by the first change
+    std::vector<std::string> cmake_lines;
+    bool cmake_loaded = false;
+    bool cmake_modified = false;
+    ///Paths to add to the git index
+    std::vector<std::string> staged;
+};
 
+static std::vector<std::string> read_lines(const std::string &fname) {
     std::ifstream in(fname);
     if (!in) throw std::runtime_error("Can't open "+fname);
+    std::vector<std::string> lines;
+    std::string ln;
+    while (std::getline(in, ln)) lines.push_back(std::move(ln));
+    return lines;
+}
+
+static void write_lines(const std::string &fname, const std::vector<std::string> &lines) {
+    std::string fname_new = fname+".part";
     std::ofstream out(fname_new, std::ios::out|std::ios::trunc);
+    for (const auto &l: lines) out << l << '\n';
+    out.close();
+    std::filesystem::rename(fname_new, fname);
+}
+
+///Calls fn to modify lines of the root CMakeLists.txt, fn returns true if it modified them
+template<typename Fn>
+static bool modify_cmake(Batch &batch, Fn &&fn) {
+    if (!batch.cmake_loaded) {
+        batch.cmake_lines = read_lines(CMakeLists);
+        batch.cmake_loaded = true;
+    }
+    if (!fn(batch.cmake_lines)) return false;
+    batch.cmake_modified = true;
+    return true;
+}
 
-    bool inserted = false;
+static void git_add(Batch &batch, std::string path) {
+    batch.staged.push_back(std::move(path));
+}
 
-    while (!in.eof()) {
-        std::getline(in, ln);
-        if (ln.find("add_subdirectory(") != ln.npos && !inserted) {
-            inserted = true;
-            fn(out);
-        }
-        out << ln << std::endl;
+///Writes the root CMakeLists.txt and stages all changes by one git add
+static void commit_batch(Batch &batch) {
+    if (batch.cmake_modified) {
+        write_lines(CMakeLists, batch.cmake_lines);
+        batch.cmake_modified = false;
+        batch.staged.push_back(CMakeLists);
     }
-    if (!inserted) {
-        fn(out);
+    if (!batch.staged.empty()) {
+        std::sort(batch.staged.begin(), batch.staged.end());
+        batch.staged.erase(std::unique(batch.staged.begin(), batch.staged.end()), batch.staged.end());
+        std::string cmd = "git add";
+        for (const auto &p: batch.staged) cmd.append(" ").append(p);
+        batch.staged.clear();
+        SYSTEM(cmd.c_str());
     }
-    in.close();
-    out.close();
+}
 
-    std::filesystem::rename(fname_new, fname);
+///Runs the command fn(batch) and commits its changes. They are committed also when the command fails,
+///so the project is consistent with the created files
+template<typename Fn>
+static int run_batch(Fn &&fn) {
+    Batch batch;
+    int ret;
+    try {
+        ret = fn(batch);
+    } catch (...) {
+        commit_batch(batch);
+        throw;
+    }
+    commit_batch(batch);
+    return ret;
+}
+
+///Returns true, if the line adds a target or a module to the project, which must be added only once
+static bool is_unique_cmake_line(std::string_view l) {
+    for (std::string_view cmd: {"add_subdirectory(", "include(", "import_library("}) {
+        if (l.compare(0, cmd.size(), cmd) == 0) return true;
+    }
+    return false;
+}
+
+static bool cmake_contains(Batch &batch, const std::string &line) {
+    bool found = false;
+    modify_cmake(batch, [&](std::vector<std::string> &lines){
+        found = std::find(lines.begin(), lines.end(), line) != lines.end();
+        return false;
+    });
+    return found;
+}
+
+template<typename Fn>
+static void insert_to_cmake(Batch &batch, Fn &&fn, std::string_view before = "add_subdirectory(") {
+    std::ostringstream buff;
+    fn(buff);
+    std::vector<std::string> ins;
+    std::istringstream in(buff.str());
+    std::string ln;
+    while (std::getline(in, ln)) ins.push_back(std::move(ln));
+
+    modify_cmake(batch, [&](std::vector<std::string> &lines){
+        //a target or module added again is reported, other blocks (enable_testing()) are inserted only once
+        bool unique = false;
+        for (const auto &l: ins) {
+            if (!is_unique_cmake_line(l)) continue;
+            if (std::find(lines.begin(), lines.end(), l) != lines.end()) {
+                throw std::runtime_error(l+" is already in " CMakeLists);
+            }
+            unique = true;
+        }
+        if (!unique && std::search(lines.begin(), lines.end(), ins.begin(), ins.end()) != lines.end()) return false;
+        //the version library precedes the include directories of the project
+        auto iter = std::find_if(lines.begin(), lines.end(), [&](const std::string &l){
+            if (l == "add_subdirectory(\"version\")") return false;
+            return l.find(before) != l.npos || l.find("add_subdirectory(") != l.npos;
+        });
+        lines.insert(iter, ins.begin(), ins.end());
+        return true;
+    });
 }
 
+///Installs CMake module to an existing project, if it is not installed yet
+template<typename Fn>
+static void ensure_cmake_module(Batch &batch, std::string module, Fn &&install) {
+    auto path = cmake_modules/(module+".cmake");
+    if (std::filesystem::exists(path)) return;
+    install();
+    //the module is still included, if only its file was removed
+    std::string include = "include("+path.string()+")";
+    //modules must be included before any library.cmake
+    if (!cmake_contains(batch, include)) insert_to_cmake(batch, [&](std::ostream &out){
+        out << include << "\n";
+    }, "include(");
+    //including helper scripts of the module
+    git_add(batch, cmake_modules.string());
+}
 
-static int add_empty_lib(std::string name) {
+static int add_empty_lib(Batch &batch, std::string name, const TargetOptions &opts) {
     using namespace std::filesystem;
     auto path = src/name;
     if (exists(path)) {
         throw std::runtime_error("already exists");
     }
+    check_modules(opts, detect_generator());
     std::string p = path;
 
-    insert_to_cmake([&](std::ostream &out){
+    insert_to_cmake(batch, [&](std::ostream &out){
         out << "add_subdirectory(\""<< p << "\")\n";
     });
     create_directories(path);
-    create_main_source(name, false, false);
-    create_main_header(name, false);
-    create_lib_cmake(name,false);
+    if (opts.modules) {
+        create_module_sources(name, opts.kind);
+        ensure_cmake_module(batch, "CxxModules", install_cxx_modules_module);
+    } else {
+        if (opts.kind != LibraryKind::interface) create_main_source(name, false, false);
+        create_main_header(name, false, opts.kind);
+    }
+    if (opts.unity) ensure_cmake_module(batch, "UnityBuild", install_unity_build_module);
+    create_lib_cmake(name,false, opts);
 
-    SYSTEM(("git add "+p).c_str());
+    git_add(batch, p);
     return 0;
 }
 
-static int add_empty_exec(std::string name) {
+static int add_empty_exec(Batch &batch, std::string name, const TargetOptions &opts) {
     using namespace std::filesystem;
     auto path = src/name;
     if (exists(path)) {
@@ -469,19 +3035,28 @@ static int add_empty_exec(std::string name) {
     }
     std::string p = path;
 
-    insert_to_cmake([&](std::ostream &out){
+    insert_to_cmake(batch, [&](std::ostream &out){
         out << "add_subdirectory(\""<< p << "\")\n";
     });
+    //the tracing library is shared by all executables
+    std::string tracing = "add_subdirectory(\""+src_cxxtrace.string()+"\")";
+    if (opts.tracing && !cmake_contains(batch, tracing)) insert_to_cmake(batch, [&](std::ostream &out){
+        out << tracing << "\n";
+    });
     create_directories(path);
-    create_main_source(name, true, false);
+    create_main_source(name, true, false, opts.tracing);
     create_main_header(name, true);
-    create_exec_cmake(name,false);
+    if (opts.unity) ensure_cmake_module(batch, "UnityBuild", install_unity_build_module);
+    if (opts.tracing) install_tracing_library();
+    ensure_cmake_module(batch, "MultiIsa", install_multi_isa_module);
+    create_exec_cmake(name,false, opts);
 
-    SYSTEM(("git add "+p).c_str());
+    git_add(batch, p);
+    if (opts.tracing) git_add(batch, src_cxxtrace.string());
     return 0;
 }
 
-static int add_tests(std::string name) {
+static int add_tests(Batch &batch, std::string name, const TargetOptions &opts) {
     using namespace std::filesystem;
     auto path = src/name;
     if (exists(path)) {
@@ -489,98 +3064,1735 @@ static int add_tests(std::string name) {
     }
     std::string p = path;
 
-    insert_to_cmake([&](std::ostream &out){
+    //executable projects don't enable testing, their tests would not be registered to ctest
+    insert_to_cmake(batch, [&](std::ostream &out){
+        out << "enable_testing()\n";
+    });
+    insert_to_cmake(batch, [&](std::ostream &out){
         out << "add_subdirectory(\""<< p << "\")\n";
     });
     create_directories(path);
-    create_test_source("", name);
-    create_test_cmake("",name);
+    if (opts.single_binary) install_test_harness();
+    create_test_source("", name, opts.single_binary);
+    create_test_cmake("",name, opts.single_binary);
 
-    SYSTEM(("git add "+p).c_str());
+    git_add(batch, p);
+    if (opts.single_binary) git_add(batch, src_cxxtest.string());
     return 0;
 }
 
-static int add_git_lib(std::string name, std::string url, std::string branch) {
+static int add_benchmark(Batch &batch, std::string name) {
     using namespace std::filesystem;
     auto path = src/name;
     if (exists(path)) {
         throw std::runtime_error("already exists");
     }
+    std::string p = path;
 
-    auto cmd = std::string("git submodule add ");
-    if (!branch.empty()) cmd.append("-b ").append(branch).append(" ");
-    cmd.append(url).append(" ").append(path);
-    if (system(cmd.c_str()) != 0) {
-        throw std::runtime_error("Git command failed, stop");
-    }
+    insert_to_cmake(batch, [&](std::ostream &out){
+        out << "add_subdirectory(\""<< p << "\")\n";
+    });
+    create_directories(path);
+    install_bench_harness();
+    create_bench_source(name);
+    create_bench_cmake(name);
 
-    auto libcmake = src/name/"library.cmake";
-    if (exists(libcmake)) {
-        insert_to_cmake([&](std::ostream &out) {
-            out << "include(" << libcmake.string() << ")\n";
-        });
-    }
+    git_add(batch, p);
+    git_add(batch, src_cxxbench.string());
     return 0;
 }
 
+///Removes unconditional submodule update of an older root CMakeLists.txt, which is replaced by the Submodules module
+static void migrate_submodule_update(Batch &batch) {
+    ensure_cmake_module(batch, "Submodules", install_submodules_module);
+    //older version of the module checks out duplicates of libraries
+    if (install_submodules_module()) git_add(batch, (cmake_modules/"Submodules.cmake").string());
 
+    modify_cmake(batch, [](std::vector<std::string> &lines){
+        auto iter = std::find_if(lines.begin(), lines.end(), [](const std::string &l){
+            return l.find("execute_process(") != l.npos && l.find("submodule update --init") != l.npos;
+        });
+        if (iter == lines.end()) return false;
+        if (iter != lines.begin() && iter+1 != lines.end() && *(iter-1) == "if(GIT_EXECUTABLE)" && *(iter+1) == "endif()") {
+            lines.erase(iter-1, iter+2);
+        } else {
+            lines.erase(iter);
+        }
+        return true;
+    });
+}
 
-int main(int argc, char **argv) {
-
-    try {
-    if (argc > 1) {
+static std::string_view trim(std::string_view s) {
+    auto b = s.find_first_not_of(" \t\r");
+    if (b == s.npos) return {};
+    auto e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e-b+1);
+}
 
-        std::string_view arg1 = argv[1];
+///Submodule recorded in .gitmodules
+struct GitModule {
+    std::string path;
+    std::string url;
+    std::string branch;
+};
 
-        if (arg1 == "-h" || arg1 == "--help") {
-            std::cout << "Usage: cxxproject <command> <args...>\n"
-                    "\n"
-                    "create executable <name>        create C++ executable\n"
-                    "create library <name>           create C++ library\n"
-                    "add library <name>              add empty library\n"
-                    "add library <name> <gitpath>    add library from git\n"
-                    "add library <name> <gitpath> <branch>\n"
-                    "                                add library from git - branch\n"
-                    "                (automatically includes library.cmake if exists)\n"
-                    "add executable <name>           add new executable\n"
-                    "add tests <name>                add new test directory\n";
-            return 0;
+static std::vector<GitModule> read_gitmodules(const std::filesystem::path &file) {
+    std::vector<GitModule> out;
+    std::ifstream in(file);
+    std::string ln;
+    while (std::getline(in, ln)) {
+        std::string_view l = trim(ln);
+        if (l.empty() || l[0] == '#' || l[0] == ';') continue;
+        if (l[0] == '[') {
+            out.emplace_back();
+            continue;
         }
-        if (arg1 == "create") {
-            if (argc > 3) {
-                std::string_view arg2 = argv[2];
-                std::string_view arg3 = argv[3];
-                if (arg2 == "executable") {
-                    return create_exec(std::string(arg3));
-                } else if (arg2 == "library") {
-                    return create_lib(std::string(arg3));
-                }
-            }
+        auto eq = l.find('=');
+        if (eq == l.npos || out.empty()) continue;
+        std::string_view key = trim(l.substr(0, eq));
+        std::string value(trim(l.substr(eq+1)));
+        if (key == "path") out.back().path = value;
+        else if (key == "url") out.back().url = value;
+        else if (key == "branch") out.back().branch = value;
+    }
+    return out;
+}
+
+///Removes .git and trailing slashes, so the same repository has the same URL
+static std::string normalize_git_url(std::string url) {
+    while (!url.empty() && url.back() == '/') url.pop_back();
+    if (url.size() > 4 && url.compare(url.size()-4, 4, ".git") == 0) url.resize(url.size()-4);
+    while (!url.empty() && url.back() == '/') url.pop_back();
+    return url;
+}
+
+///Resolves URL of a nested submodule relative to the URL of its parent repository
+static std::string resolve_git_url(std::string base, std::string url) {
+    if (url.compare(0, 2, "./") != 0 && url.compare(0, 3, "../") != 0) return normalize_git_url(url);
+    base = normalize_git_url(base);
+    while (true) {
+        if (url.compare(0, 2, "./") == 0) {
+            url.erase(0, 2);
+        } else if (url.compare(0, 3, "../") == 0) {
+            url.erase(0, 3);
+            auto sep = base.rfind('/');
+            if (sep != base.npos) base.resize(sep);
+        } else {
+            break;
+        }
+    }
+    return normalize_git_url(base+"/"+url);
+}
+
+///Returns output of the command (without the trailing newline), empty string if it fails
+static std::string command_output(const std::string &cmd) {
+    std::string out;
+    FILE *f = popen(cmd.c_str(), "r");
+    if (!f) return out;
+    char buff[256];
+    while (fgets(buff, sizeof(buff), f)) out.append(buff);
+    if (pclose(f) != 0) out.clear();
+    while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
+    return out;
+}
+
+///Libraries imported by the root CMakeLists.txt of the project in dir - pairs of name and path
+static std::vector<std::pair<std::string, std::string> > imported_libraries(const std::filesystem::path &dir) {
+    std::vector<std::pair<std::string, std::string> > out;
+    std::ifstream in(dir/CMakeLists);
+    std::string ln;
+    while (std::getline(in, ln)) {
+        std::string_view l = trim(ln);
+        if (l.substr(0, 15) == "import_library(" && l.back() == ')') {
+            std::istringstream args(std::string(l.substr(15, l.size()-16)));
+            std::string name, path;
+            if (args >> name >> path) out.emplace_back(name, path);
+        } else if (l.substr(0, 8) == "include(" && l.size() > 23 && l.substr(l.size()-15) == "/library.cmake)") {
+            std::filesystem::path path(std::string(l.substr(8, l.size()-23)));
+            out.emplace_back(path.filename().string(), path.string());
+        }
+    }
+    return out;
+}
+
+///Library of the flattened set of libraries imported from git
+struct ResolvedLibrary {
+    std::string name;
+    std::filesystem::path path;
+    std::string url;
+    std::string branch;
+    ///Libraries, which the library imports
+    std::vector<std::string> deps;
+};
+
+///Resolves libraries imported by the library in path. A library not present in the project yet is added
+///as submodule of the project, so each library (URL) has only one checkout. Nested submodules, which are
+///not libraries, stay in the library. Libraries are appended to the list after their dependencies.
+static void resolve_git_libraries(Batch &batch, ResolvedLibrary lib, const SubmoduleOptions &opts, std::vector<GitModule> &project,
+                                  std::vector<ResolvedLibrary> &resolved, std::vector<std::string> &conflicts) {
+    using namespace std::filesystem;
+    auto nested = read_gitmodules(lib.path/".gitmodules");
+    for (const auto &dep: imported_libraries(lib.path)) {
+        auto iter = std::find_if(nested.begin(), nested.end(), [&](const GitModule &m){
+            return path(m.path).lexically_normal() == path(dep.second).lexically_normal();
+        });
+        if (iter == nested.end()) continue;
+        std::string url = resolve_git_url(lib.url, iter->url);
+        lib.deps.push_back(dep.first);
+        //commit of the dependency, which the library was tested with
+        std::string commit = command_output("git -C "+lib.path.string()+" rev-parse HEAD:"+iter->path);
+
+        auto same = std::find_if(project.begin(), project.end(), [&](const GitModule &m){
+            return normalize_git_url(m.url) == url;
+        });
+        if (same != project.end()) {
+            //the library is already in the project
+            if (same->branch != iter->branch) {
+                auto branch_name = [](const std::string &b) {
+                    return b.empty()?std::string("the default branch"):"branch '"+b+"'";
+                };
+                conflicts.push_back(dep.first+": "+lib.name+" requests "+branch_name(iter->branch)+", but "
+                                    +same->path+" follows "+branch_name(same->branch));
+            } else if (!commit.empty() && commit != command_output("git -C "+same->path+" rev-parse HEAD")) {
+                conflicts.push_back(dep.first+": "+lib.name+" is tested with commit "+commit.substr(0, 12)
+                                    +", but "+same->path+" is checked out at a different commit");
+            }
+            continue;
+        }
+        auto dep_path = src/dep.first;
+        if (exists(dep_path)) {
+            throw std::runtime_error("Can't add "+url+" required by "+lib.name+", "+dep_path.string()+" already exists");
+        }
+        auto cmd = std::string("git submodule add ");
+        if (!iter->branch.empty()) cmd.append("-b ").append(iter->branch).append(" ");
+        if (opts.depth) cmd.append("--depth ").append(std::to_string(opts.depth)).append(" ");
+        cmd.append(url).append(" ").append(dep_path);
+        if (system(cmd.c_str()) != 0) {
+            throw std::runtime_error("Git command failed, stop");
+        }
+        if (opts.depth) {
+            SYSTEM(("git config -f .gitmodules submodule."+dep_path.string()+".shallow true").c_str());
+        }
+        if (!commit.empty() && system(("git -C "+dep_path.string()+" checkout -q "+commit).c_str()) != 0) {
+            conflicts.push_back(dep.first+": commit "+commit.substr(0, 12)+" required by "+lib.name+" is not available, "
+                                +dep_path.string()+" is checked out at the head of the branch");
+        }
+        project.push_back({dep_path.string(), url, iter->branch});
+        git_add(batch, dep_path);
+        resolve_git_libraries(batch, {dep.first, dep_path, url, iter->branch, {}}, opts, project, resolved, conflicts);
+    }
+    //the other nested submodules are used by the library itself
+    std::string init;
+    for (const auto &m: nested) {
+        bool duplicate = std::any_of(project.begin(), project.end(), [&](const GitModule &p){
+            return normalize_git_url(p.url) == resolve_git_url(lib.url, m.url);
+        });
+        if (!duplicate) init.append(" ").append(m.path);
+    }
+    if (!init.empty()) {
+        auto cmd = "git -C "+lib.path.string()+" submodule update --init --recursive --recommend-shallow";
+        if (opts.jobs) cmd.append(" --jobs ").append(std::to_string(opts.jobs));
+        cmd.append(" --").append(init);
+        if (system(cmd.c_str()) != 0) {
+            throw std::runtime_error("Git command failed, stop");
+        }
+    }
+    resolved.push_back(std::move(lib));
+}
+
+static void print_library_graph(const std::vector<ResolvedLibrary> &resolved, const std::string &name, int level) {
+    auto iter = std::find_if(resolved.begin(), resolved.end(), [&](const ResolvedLibrary &l){return l.name == name;});
+    std::cout << std::string(2*level+2, ' ') << name;
+    if (iter != resolved.end()) {
+        std::cout << " (" << iter->path.string() << ", " << iter->url;
+        if (!iter->branch.empty()) std::cout << ", branch " << iter->branch;
+        std::cout << ")\n";
+        for (const auto &d: iter->deps) print_library_graph(resolved, d, level+1);
+    } else {
+        std::cout << " (already in the project)\n";
+    }
+}
+
+static int add_git_lib(Batch &batch, std::string name, std::string url, std::string branch, const SubmoduleOptions &opts) {
+    using namespace std::filesystem;
+    auto path = src/name;
+    if (exists(path)) {
+        throw std::runtime_error("already exists");
+    }
+    auto project = read_gitmodules(".gitmodules");
+    auto same = std::find_if(project.begin(), project.end(), [&](const GitModule &m){
+        return normalize_git_url(m.url) == normalize_git_url(url);
+    });
+    if (same != project.end()) {
+        throw std::runtime_error("The library is already imported as "+same->path);
+    }
+
+    auto cmd = std::string("git submodule add ");
+    if (!branch.empty()) cmd.append("-b ").append(branch).append(" ");
+    if (opts.depth) cmd.append("--depth ").append(std::to_string(opts.depth)).append(" ");
+    cmd.append(url).append(" ").append(path);
+    if (system(cmd.c_str()) != 0) {
+        throw std::runtime_error("Git command failed, stop");
+    }
+    if (opts.depth) {
+        //configure and clones of the project fetch the library without history as well
+        SYSTEM(("git config -f .gitmodules submodule."+path.string()+".shallow true").c_str());
+        git_add(batch, ".gitmodules");
+    }
+    //libraries imported by the library are added to the project, other nested submodules are checked out
+    std::vector<ResolvedLibrary> resolved;
+    std::vector<std::string> conflicts;
+    //.gitmodules of the project with the submodules added by this command
+    project.push_back({path.string(), url, branch});
+    resolve_git_libraries(batch, {name, path, normalize_git_url(url), branch, {}}, opts, project, resolved, conflicts);
+    if (resolved.size() > 1) git_add(batch, ".gitmodules");
+    migrate_submodule_update(batch);
+    if (opts.jobs) {
+        //default of SUBMODULE_JOBS for all build trees and clones of the project
+        std::string jobs = "set(SUBMODULE_DEFAULT_JOBS "+std::to_string(opts.jobs)+")";
+        modify_cmake(batch, [&](std::vector<std::string> &lines){
+            auto iter = std::find_if(lines.begin(), lines.end(), [](const std::string &l){
+                return l.compare(0, 27, "set(SUBMODULE_DEFAULT_JOBS ") == 0;
+            });
+            if (iter != lines.end()) {
+                if (*iter == jobs) return false;
+                *iter = jobs;
+            } else {
+                lines.insert(std::find(lines.begin(), lines.end(), "include("+(cmake_modules/"Submodules.cmake").string()+")"), jobs);
+            }
+            return true;
+        });
+    }
+
+    //dependencies are imported before the libraries using them
+    for (const auto &l: resolved) {
+        if (!exists(l.path/"library.cmake")) continue;
+        //uses the prebuilt package of the library if it is available, otherwise includes library.cmake
+        ensure_cmake_module(batch, "Prebuilt", install_prebuilt_module);
+        insert_to_cmake(batch, [&](std::ostream &out) {
+            out << "import_library(" << l.name << " " << l.path.string() << ")\n";
+        });
+    }
+    std::cout << "Libraries:\n";
+    print_library_graph(resolved, name, 0);
+    for (const auto &c: conflicts) {
+        std::cerr << "Version conflict: " << c << std::endl;
+    }
+    return 0;
+}
+
+
+///Returns description of the profile - the first comment of the file
+static std::string profile_description(const std::filesystem::path &file) {
+    std::ifstream in(file);
+    std::string ln;
+    while (std::getline(in, ln)) {
+        auto pos = ln.find_first_not_of("# \t");
+        if (!ln.empty() && ln[0] == '#' && pos != ln.npos) return ln.substr(pos);
+    }
+    return {};
+}
+
+static int profile_list() {
+    using namespace std::filesystem;
+    std::string current = "default_build_profile.conf";
+    std::ifstream cur(".current_profile.mk");
+    std::string ln;
+    if (std::getline(cur, ln) && ln.substr(0,14) == "BUILD_PROFILE=") current = ln.substr(14);
+
+    std::vector<path> files;
+    if (exists("default_build_profile.conf")) files.push_back("default_build_profile.conf");
+    if (is_directory(profiles)) {
+        std::vector<path> tmp;
+        for (const auto &e: directory_iterator(profiles)) {
+            if (e.path().extension() == ".conf") tmp.push_back(e.path());
+        }
+        std::sort(tmp.begin(), tmp.end());
+        files.insert(files.end(), tmp.begin(), tmp.end());
+    }
+    for (const auto &f: files) {
+        std::string name = f.parent_path() == profiles?f.stem().string():f.string();
+        std::cout << (f == path(current)?"* ":"  ") << name;
+        std::cout << std::string(name.size() < 28?28-name.size():1, ' ') << profile_description(f) << "\n";
+    }
+    std::cout << "\nAvailable templates:";
+    for (const auto &t: profile_templates) std::cout << " " << t.name;
+    std::cout << "\nUse: make BUILD_PROFILE=<name>" << std::endl;
+    return 0;
+}
+
+static int profile_add(Batch &batch, std::string name, std::string from) {
+    using namespace std::filesystem;
+    if (name.empty() || name.find('/') != name.npos) throw std::runtime_error("Invalid profile name: "+name);
+    auto file = profiles/(name+".conf");
+    if (exists(file)) throw std::runtime_error("already exists");
+    auto iter = std::find_if(std::begin(profile_templates), std::end(profile_templates), [&](const ProfileTemplate &t){
+        return t.name == name;
+    });
+    if (iter != std::end(profile_templates) && from.empty()) {
+        if (iter->module == "BuildTrace") ensure_cmake_module(batch, "BuildTrace", install_build_trace_module);
+        else if (iter->module == "MultiIsa") ensure_cmake_module(batch, "MultiIsa", install_multi_isa_module);
+        else ensure_cmake_module(batch, "Optimization", install_optimization_module);
+        install_profile(*iter);
+    } else {
+        path source = from.empty()?path("default_build_profile.conf"):profiles/(from+".conf");
+        if (!exists(source)) throw std::runtime_error("Profile not found: "+source.string());
+        create_directories(profiles);
+        copy_file(source, file);
+    }
+    git_add(batch, file.string());
+    std::cout << "Profile created: " << file.string() << "\nUse: make BUILD_PROFILE=" << name << std::endl;
+    return 0;
+}
+
+///Replaces output directories of an existing root CMakeLists.txt with OUTPUT_DIR
+static void migrate_output_dirs(Batch &batch) {
+    modify_cmake(batch, [](std::vector<std::string> &lines){
+        for (const auto &l: lines) {
+            if (l.find("OUTPUT_DIR}") != l.npos) return false;    //already migrated
+        }
+        std::vector<std::string> out;
+        std::string_view binary_dir = "${CMAKE_BINARY_DIR}/";
+        bool defined = false;
+        for (auto &l: lines) {
+            auto pos = l.find(binary_dir);
+            if (l.find("_OUTPUT_DIRECTORY") != l.npos && pos != l.npos) {
+                if (!defined) {
+                    std::istringstream def(OUTPUT_DIR_DEFINITION);
+                    std::string ln;
+                    while (std::getline(def, ln)) out.push_back(std::move(ln));
+                    defined = true;
+                }
+                l.replace(pos, binary_dir.size(), "${OUTPUT_DIR}/");
+            }
+            out.push_back(std::move(l));
+        }
+        lines = std::move(out);
+        return defined;
+    });
+}
+
+static int update_makefile(Batch &batch, Generator gen) {
+    if (!std::filesystem::exists(CMakeLists) || !std::filesystem::exists("Makefile")) {
+        throw std::runtime_error("Current directory is not a root of a project");
+    }
+    install_makefile(gen);
+    install_perf_check_scripts();
+    //modules of the targets of the Makefile (link-bench, profile, pgo, unity-check, cache-stats),
+    //each is included before the previous ones, so the order is the same as in a new project
+    ensure_cmake_module(batch, "FastLink", install_fast_link_module);
+    ensure_cmake_module(batch, "Profiling", install_profiling_module);
+    ensure_cmake_module(batch, "PGO", install_pgo_module);
+    ensure_cmake_module(batch, "UnityBuild", install_unity_build_module);
+    ensure_cmake_module(batch, "CompilerCache", install_compiler_cache_module);
+    if (!cmake_contains(batch, BUILD_PROFILE_FILE_LINE)) insert_to_cmake(batch, [](std::ostream &out){
+        out << BUILD_PROFILE_FILE_DEFINITION;
+    }, "include(");
+    if (gen == Generator::ninja) {
+        migrate_output_dirs(batch);
+    }
+    git_add(batch, "Makefile");
+    git_add(batch, cmake_modules.string());
+    std::cout << "Makefile updated. Enter `make distclean` to remove build trees of the previous generator." << std::endl;
+    return 0;
+}
+
+///Section [<kind> <name>] of the manifest
+struct ManifestEntry {
+    std::string kind;
+    std::string name;
+    std::map<std::string, std::string, std::less<> > values;
+    unsigned int line = 0;
+
+    std::string_view get(std::string_view key, std::string_view def = {}) const {
+        auto iter = values.find(key);
+        return iter == values.end()?def:std::string_view(iter->second);
+    }
+    bool flag(std::string_view key) const {
+        std::string_view v = get(key, "false");
+        if (v == "true" || v == "yes" || v == "on" || v == "1") return true;
+        if (v == "false" || v == "no" || v == "off" || v == "0") return false;
+        throw std::runtime_error("Line "+std::to_string(line)+": invalid value of "+std::string(key)+": "+std::string(v));
+    }
+    unsigned int count(std::string_view key) const {
+        std::string_view v = get(key, "0");
+        if (v.empty() || v.find_first_not_of("0123456789") != v.npos || v.size() > 6) {
+            throw std::runtime_error("Line "+std::to_string(line)+": invalid value of "+std::string(key)+": "+std::string(v));
+        }
+        return static_cast<unsigned int>(std::stoul(std::string(v)));
+    }
+};
+
+///Parses manifest for 'apply' - INI like file with sections [executable|library|tests|benchmark <name>]
+///and optional [project <name>] (keys type, generator), which is used when the project doesn't exist yet
+static std::vector<ManifestEntry> parse_manifest(const std::string &fname) {
+    static const std::map<std::string_view, std::vector<std::string_view> > allowed_keys = {
+        {"project", {"type", "generator", "unity", "single-binary", "kind", "modules", "tracing"}},
+        {"executable", {"unity", "tracing"}},
+        {"library", {"unity", "kind", "modules", "url", "branch", "shallow", "depth", "jobs"}},
+        {"tests", {"single-binary"}},
+        {"benchmark", {}},
+    };
+    std::vector<ManifestEntry> out;
+    auto lines = read_lines(fname);
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        std::string_view ln = trim(lines[i]);
+        auto error = [&](std::string_view msg) {
+            return std::runtime_error(fname+":"+std::to_string(i+1)+": "+std::string(msg));
+        };
+        if (ln.empty() || ln[0] == '#' || ln[0] == ';') continue;
+        if (ln[0] == '[') {
+            if (ln.back() != ']') throw error("expected [<kind> <name>]");
+            std::string_view sect = trim(ln.substr(1, ln.size()-2));
+            auto sep = sect.find_first_of(" \t");
+            if (sep == sect.npos) throw error("expected [<kind> <name>]");
+            ManifestEntry e;
+            e.kind = sect.substr(0, sep);
+            e.name = trim(sect.substr(sep));
+            e.line = i+1;
+            if (allowed_keys.find(e.kind) == allowed_keys.end()) throw error("unknown kind: "+e.kind);
+            if (e.name.find_first_of("/\\ \t") != e.name.npos) throw error("invalid name: "+e.name);
+            out.push_back(std::move(e));
+        } else {
+            auto eq = ln.find('=');
+            if (eq == ln.npos) throw error("expected <key> = <value>");
+            if (out.empty()) throw error("key outside of a section");
+            std::string_view key = trim(ln.substr(0, eq));
+            std::string_view value = trim(ln.substr(eq+1));
+            const auto &keys = allowed_keys.at(out.back().kind);
+            if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                throw error("unknown key for "+out.back().kind+": "+std::string(key));
+            }
+            out.back().values[std::string(key)] = value;
+        }
+    }
+    return out;
+}
+
+static TargetOptions manifest_target_options(const ManifestEntry &e) {
+    TargetOptions opts;
+    opts.unity = e.flag("unity");
+    opts.single_binary = e.flag("single-binary");
+    opts.kind = parse_library_kind(e.get("kind", "static"));
+    opts.modules = e.flag("modules");
+    opts.tracing = e.flag("tracing");
+    return opts;
+}
+
+///Creates or extends the project by the manifest. Existing parts are skipped, the changes are staged by one git add
+static int apply_manifest(std::string fname) {
+    using namespace std::filesystem;
+    auto entries = parse_manifest(fname);
+
+    if (!exists(CMakeLists)) {
+        auto prj = std::find_if(entries.begin(), entries.end(), [](const ManifestEntry &e){return e.kind == "project";});
+        if (prj == entries.end()) {
+            throw std::runtime_error("Current directory is not a root of a project and the manifest has no [project <name>] section");
+        }
+        Generator gen = parse_generator(prj->get("generator", prj->flag("modules")?"ninja":"make"));
+        std::string_view type = prj->get("type", "executable");
+        if (type == "executable" && prj->values.count("kind")) {
+            throw std::runtime_error(fname+":"+std::to_string(prj->line)+": key kind is accepted only by library projects");
+        }
+        if (type == "executable") create_exec(prj->name, gen, manifest_target_options(*prj));
+        else if (type == "library") create_lib(prj->name, gen, manifest_target_options(*prj));
+        else throw std::runtime_error("Unknown type of the project: "+std::string(type));
+    }
+
+    unsigned int added = 0;
+    run_batch([&](Batch &batch){
+        for (const auto &e: entries) {
+            if (e.kind == "project" || exists(src/e.name)) continue;
+            std::cout << "Adding " << e.kind << " " << e.name << std::endl;
+            if (e.kind == "executable") {
+                add_empty_exec(batch, e.name, manifest_target_options(e));
+            } else if (e.kind == "library") {
+                if (e.values.count("url")) {
+                    SubmoduleOptions opts;
+                    opts.depth = e.flag("shallow")?1:e.count("depth");
+                    opts.jobs = e.count("jobs");
+                    add_git_lib(batch, e.name, std::string(e.get("url")), std::string(e.get("branch")), opts);
+                } else {
+                    add_empty_lib(batch, e.name, manifest_target_options(e));
+                }
+            } else if (e.kind == "tests") {
+                add_tests(batch, e.name, manifest_target_options(e));
+            } else if (e.kind == "benchmark") {
+                add_benchmark(batch, e.name);
+            }
+            ++added;
+        }
+        return 0;
+    });
+    if (added) std::cout << "Added " << added << " item(s), changes are staged" << std::endl;
+    else std::cout << "Project is up to date" << std::endl;
+    return 0;
+}
+
+///Minimal JSON value, used to read time traces of Clang
+struct JsonValue {
+    enum Type {null, boolean, number, string, array, object};
+    Type type = null;
+    double num = 0;
+    std::string str;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue> > fields;
+
+    const JsonValue *get(std::string_view key) const {
+        for (const auto &f: fields) if (f.first == key) return &f.second;
+        return nullptr;
+    }
+};
+
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view text):_text(text) {}
+
+    JsonValue parse() {
+        JsonValue v;
+        skip_ws();
+        if (_pos >= _text.size()) throw std::runtime_error("unexpected end of JSON");
+        char c = _text[_pos];
+        if (c == '{') {
+            v.type = JsonValue::object;
+            ++_pos;
+            if (consume('}')) return v;
+            do {
+                std::string key = parse_string();
+                if (!consume(':')) throw std::runtime_error("expected ':' in JSON");
+                v.fields.emplace_back(std::move(key), parse());
+            } while (consume(','));
+            if (!consume('}')) throw std::runtime_error("expected '}' in JSON");
+        } else if (c == '[') {
+            v.type = JsonValue::array;
+            ++_pos;
+            if (consume(']')) return v;
+            do {
+                v.items.push_back(parse());
+            } while (consume(','));
+            if (!consume(']')) throw std::runtime_error("expected ']' in JSON");
+        } else if (c == '"') {
+            v.type = JsonValue::string;
+            v.str = parse_string();
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            auto end = _text.find_first_of(",]} \t\r\n", _pos);
+            auto word = _text.substr(_pos, end-_pos);
+            _pos += word.size();
+            v.type = word == "null"?JsonValue::null:JsonValue::boolean;
+            v.num = word == "true"?1:0;
+        } else {
+            auto end = _text.find_first_of(",]} \t\r\n", _pos);
+            v.type = JsonValue::number;
+            v.num = std::strtod(std::string(_text.substr(_pos, end-_pos)).c_str(), nullptr);
+            _pos = end == _text.npos?_text.size():end;
+        }
+        return v;
+    }
+
+protected:
+    std::string_view _text;
+    std::size_t _pos = 0;
+
+    void skip_ws() {
+        while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos]))) ++_pos;
+    }
+    bool consume(char c) {
+        skip_ws();
+        if (_pos < _text.size() && _text[_pos] == c) {
+            ++_pos;
+            return true;
+        }
+        return false;
+    }
+    std::string parse_string() {
+        if (!consume('"')) throw std::runtime_error("expected string in JSON");
+        std::string out;
+        while (_pos < _text.size() && _text[_pos] != '"') {
+            char c = _text[_pos++];
+            if (c == '\\' && _pos < _text.size()) {
+                c = _text[_pos++];
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    //names of sources and symbols are ASCII
+                    case 'u': _pos += 4; c = '?'; break;
+                    default: break;
+                }
+            }
+            out.push_back(c);
+        }
+        ++_pos;
+        return out;
+    }
+};
+
+static std::string json_string(std::string_view str) {
+    std::string out = "\"";
+    for (char c: str) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (c == '\n') out.append("\\n");
+        else if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+///Accumulated compile time of a translation unit, header, template or target
+struct BuildCost {
+    std::string name;
+    std::string target;
+    double ms = 0;
+    unsigned int count = 0;
+};
+
+struct BuildReport {
+    std::string compiler;
+    std::vector<BuildCost> units;
+    std::map<std::string, BuildCost> targets;
+    std::map<std::string, BuildCost> headers;
+    std::map<std::string, BuildCost> templates;
+};
+
+static void add_cost(std::map<std::string, BuildCost> &map, const std::string &name, double ms) {
+    BuildCost &c = map[name];
+    c.name = name;
+    c.ms += ms;
+    c.count++;
+}
+
+///Reads time trace of Clang (-ftime-trace)
+static double read_clang_trace(const std::filesystem::path &file, BuildReport &report) {
+    std::ifstream in(file);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    JsonValue root = JsonReader(text).parse();
+    const JsonValue *events = root.get("traceEvents");
+    if (!events) return -1;
+    double total = 0;
+    for (const auto &e: events->items) {
+        const JsonValue *name = e.get("name");
+        const JsonValue *dur = e.get("dur");
+        if (!name || !dur) continue;
+        double ms = dur->num / 1000.0;
+        const JsonValue *args = e.get("args");
+        const JsonValue *detail = args?args->get("detail"):nullptr;
+        if (name->str == "ExecuteCompiler" || (name->str == "Total ExecuteCompiler" && total == 0)) {
+            total = ms;
+        } else if (name->str == "Source" && detail) {
+            //includes time of nested headers
+            add_cost(report.headers, detail->str, ms);
+        } else if ((name->str == "InstantiateClass" || name->str == "InstantiateFunction") && detail) {
+            add_cost(report.templates, detail->str, ms);
+        }
+    }
+    return total;
+}
+
+///Reads report of GCC (-ftime-report), there are only phases of the compilation without names of headers
+static double read_gcc_report(const std::filesystem::path &file, BuildReport &report) {
+    std::ifstream in(file);
+    std::string ln;
+    double total = -1;
+    bool table = false;
+    while (std::getline(in, ln)) {
+        if (ln.substr(0, 13) == "Time variable") {
+            table = true;
+            continue;
+        }
+        auto colon = ln.find(':');
+        if (!table || colon == ln.npos) continue;
+        std::string phase(trim(std::string_view(ln).substr(0, colon)));
+        //columns: usr (pct) sys (pct) wall (pct) memory (pct)
+        std::vector<double> values;
+        std::istringstream cols(ln.substr(colon+1));
+        std::string tok;
+        while (cols >> tok) {
+            if (tok.front() == '(' || tok.back() == ')') continue;
+            values.push_back(std::atof(tok.c_str()));
+        }
+        if (values.size() < 3) continue;
+        double ms = values[2] * 1000.0;
+        if (phase == "TOTAL") total = ms;
+        else if (phase == "template instantiation") add_cost(report.templates, "(all templates of the unit, GCC)", ms);
+        else if (phase == "phase parsing") add_cost(report.headers, "(parsing of all headers, GCC)", ms);
+    }
+    return total;
+}
+
+template<typename Iter>
+static void print_costs(std::ostream &out, std::string_view title, Iter beg, Iter end, bool with_target, bool with_count) {
+    out << "\n" << title << "\n";
+    for (Iter iter = beg; iter != end; ++iter) {
+        char buff[32];
+        snprintf(buff, sizeof(buff), "%10.1f ms  ", iter->ms);
+        out << buff;
+        if (with_count) out << std::setw(6) << iter->count << "x  ";
+        if (with_target) out << std::left << std::setw(20) << iter->target << std::right << " ";
+        out << iter->name << "\n";
+    }
+}
+
+template<typename Iter>
+static void json_costs(std::ostream &out, std::string_view key, Iter beg, Iter end) {
+    out << "  " << json_string(key) << ": [";
+    const char *sep = "\n";
+    for (Iter iter = beg; iter != end; ++iter) {
+        out << sep << "    {\"name\": " << json_string(iter->name);
+        if (!iter->target.empty()) out << ", \"target\": " << json_string(iter->target);
+        out << ", \"ms\": " << iter->ms << ", \"count\": " << iter->count << "}";
+        sep = ",\n";
+    }
+    out << "\n  ]";
+}
+
+static std::vector<BuildCost> ranked(const std::map<std::string, BuildCost> &map, std::size_t top) {
+    std::vector<BuildCost> out;
+    for (const auto &p: map) out.push_back(p.second);
+    std::sort(out.begin(), out.end(), [](const BuildCost &a, const BuildCost &b){return a.ms > b.ms;});
+    if (out.size() > top) out.resize(top);
+    return out;
+}
+
+///Aggregates compile time collected by the profile build-timing
+static int build_report(std::string config, std::size_t top) {
+    using namespace std::filesystem;
+    std::transform(config.begin(), config.end(), config.begin(), tolower);
+    std::string config_dir = config;
+    config_dir[0] = static_cast<char>(toupper(config_dir[0]));
+    path tree = build/"current"/config;
+    if (!exists(tree)) throw std::runtime_error("Build tree not found: "+tree.string()+" (build the project first)");
+    //Ninja Multi-Config has one tree for all configurations, objects are in <target>.dir/<Config>/
+    bool multi_config = !exists(tree/"CMakeCache.txt");
+    path scan = multi_config?tree.parent_path():tree;
+
+    BuildReport report;
+    for (auto iter = recursive_directory_iterator(scan); iter != recursive_directory_iterator(); ++iter) {
+        const path &p = iter->path();
+        if (iter->is_directory() && exists(p/"CMakeCache.txt")) {
+            //other build trees (unity-check, pgo, ...)
+            iter.disable_recursion_pending();
+            continue;
+        }
+        std::string fname = p.filename().string();
+        bool clang = fname.size() > 5 && fname.substr(fname.size()-5) == ".json";
+        bool gcc = p.extension() == ".time-report";
+        if ((!clang && !gcc) || !iter->is_regular_file()) continue;
+        //<dir>/CMakeFiles/<target>.dir/[<Config>/]<source>.o
+        path rel = p.lexically_relative(scan);
+        std::string target;
+        path dir;
+        path source;
+        int state = 0;
+        for (const auto &part: rel) {
+            std::string s = part.string();
+            if (state == 0 && s == "CMakeFiles") state = 1;
+            else if (state == 0) dir /= part;
+            else if (state == 1 && s.size() > 4 && s.substr(s.size()-4) == ".dir") {
+                target = s.substr(0, s.size()-4);
+                state = 2;
+            } else if (state == 2) source /= part;
+        }
+        if (target.empty() || source.empty()) continue;
+        if (multi_config) {
+            if (*source.begin() != config_dir) continue;
+            source = source.lexically_relative(config_dir);
+        }
+        std::string name = (dir/source).string();
+        name = name.substr(0, name.size() - (clang?5:14));   //.json or .o.time-report
+        double ms = clang?read_clang_trace(p, report):read_gcc_report(p, report);
+        if (ms < 0) continue;
+        report.compiler = clang?"clang":"gcc";
+        report.units.push_back({name, target, ms, 1});
+        add_cost(report.targets, target, ms);
+    }
+    if (report.units.empty()) {
+        throw std::runtime_error("No compile time data in "+scan.string()+". Build the project by 'make BUILD_PROFILE=build-timing' "
+                                 "(use 'cxxproject profile add build-timing' to create the profile)");
+    }
+    std::sort(report.units.begin(), report.units.end(), [](const BuildCost &a, const BuildCost &b){return a.ms > b.ms;});
+    double total = 0;
+    for (const auto &u: report.units) total += u.ms;
+    auto units = report.units;
+    if (units.size() > top) units.resize(top);
+    auto targets = ranked(report.targets, top);
+    auto headers = ranked(report.headers, top);
+    auto templates = ranked(report.templates, top);
+
+    std::ostringstream text;
+    text << "Build report of " << tree.string() << " (" << report.compiler << "): "
+         << report.units.size() << " translation units, " << static_cast<long>(total) << " ms total\n";
+    print_costs(text, "Slowest translation units:", units.begin(), units.end(), true, false);
+    print_costs(text, "Slowest targets:", targets.begin(), targets.end(), false, true);
+    print_costs(text, "Most expensive headers (total inclusion time):", headers.begin(), headers.end(), false, true);
+    print_costs(text, "Template instantiation hot spots:", templates.begin(), templates.end(), false, true);
+
+    path log = tree/log_path;
+    create_directories(log);
+    std::ofstream txt(log/"build-report.txt", std::ios::out|std::ios::trunc);
+    txt << text.str();
+    std::ofstream json(log/"build-report.json", std::ios::out|std::ios::trunc);
+    json << "{\n  \"tree\": " << json_string(tree.string()) << ",\n  \"compiler\": " << json_string(report.compiler)
+         << ",\n  \"total_ms\": " << total << ",\n";
+    json_costs(json, "units", units.begin(), units.end());
+    json << ",\n";
+    json_costs(json, "targets", targets.begin(), targets.end());
+    json << ",\n";
+    json_costs(json, "headers", headers.begin(), headers.end());
+    json << ",\n";
+    json_costs(json, "templates", templates.begin(), templates.end());
+    json << "\n}\n";
+
+    std::cout << text.str() << "\nReport written to " << (log/"build-report.txt").string()
+              << " and " << (log/"build-report.json").string() << std::endl;
+    return 0;
+}
+
+///#include directive found by the scanner
+struct IncludeDirective {
+    std::string name;
+    bool angle = false;
+};
+
+///Finds #include directives of the file without preprocessing it (conditions and comments are ignored)
+static void scan_includes(const std::string &file, std::vector<IncludeDirective> &out) {
+    std::ifstream in(file, std::ios::in|std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::size_t pos = 0;
+    const std::size_t sz = text.size();
+    while (pos < sz) {
+        while (pos < sz && (text[pos] == ' ' || text[pos] == '\t')) ++pos;
+        if (pos < sz && text[pos] == '#') {
+            ++pos;
+            while (pos < sz && (text[pos] == ' ' || text[pos] == '\t')) ++pos;
+            if (text.compare(pos, 7, "include") == 0) {
+                pos += 7;
+                while (pos < sz && (text[pos] == ' ' || text[pos] == '\t')) ++pos;
+                if (pos < sz && (text[pos] == '"' || text[pos] == '<')) {
+                    char close = text[pos] == '"'?'"':'>';
+                    auto end = text.find_first_of(std::string{close, '\n'}, pos+1);
+                    if (end != text.npos && text[end] == close) {
+                        out.push_back({text.substr(pos+1, end-pos-1), close == '>'});
+                    }
+                }
+            }
+        }
+        pos = text.find('\n', pos);
+        if (pos == text.npos) break;
+        ++pos;
+    }
+}
+
+///Include graph of the sources in src/ and of the external headers they include
+struct IncludeGraph {
+    std::vector<std::string> files;
+    std::vector<std::uintmax_t> sizes;
+    ///File is a part of the project (not an external header)
+    std::vector<bool> project;
+    ///File is a translation unit
+    std::vector<bool> source;
+    ///Resolved includes - index of the file and the directive
+    std::vector<std::vector<std::pair<int, IncludeDirective> > > includes;
+    std::unordered_map<std::string, int> index;
+
+    int add(std::string file, std::uintmax_t size, bool in_project, bool is_source) {
+        int id = static_cast<int>(files.size());
+        index.emplace(file, id);
+        files.push_back(std::move(file));
+        sizes.push_back(size);
+        project.push_back(in_project);
+        source.push_back(is_source);
+        includes.emplace_back();
+        return id;
+    }
+};
+
+static bool is_source_file(const std::filesystem::path &p) {
+    static const std::string_view exts[] = {".cpp", ".cc", ".cxx", ".c", ".cppm"};
+    auto ext = p.extension().string();
+    return std::find(std::begin(exts), std::end(exts), ext) != std::end(exts);
+}
+
+static bool is_header_file(const std::filesystem::path &p) {
+    static const std::string_view exts[] = {".h", ".hpp", ".hh", ".hxx", ".inl", ".ipp", ".tcc"};
+    auto ext = p.extension().string();
+    return std::find(std::begin(exts), std::end(exts), ext) != std::end(exts);
+}
+
+///Compiler and its flags from the cache of the configured build tree, c++ if the project is not configured
+static std::string configured_compiler() {
+    using namespace std::filesystem;
+    for (const path &tree: {build/"current"/"release", build/"current"/"debug", build/"current"}) {
+        std::ifstream in(tree/"CMakeCache.txt");
+        if (!in) continue;
+        std::string compiler, flags, ln;
+        while (std::getline(in, ln)) {
+            auto eq = ln.find('=');
+            if (eq == ln.npos) continue;
+            auto key = ln.substr(0, ln.find(':'));
+            if (key == "CMAKE_CXX_COMPILER") compiler = ln.substr(eq+1);
+            else if (key == "CMAKE_CXX_FLAGS") flags = ln.substr(eq+1);
+        }
+        if (!compiler.empty()) return "\""+compiler+"\""+(flags.empty()?"":" "+flags);
+    }
+    return "c++";
+}
+
+///Directories searched by the compiler for <...> includes outside of the project
+static std::vector<std::string> system_include_dirs() {
+    using namespace std::filesystem;
+    std::vector<std::string> out;
+    std::string compiler = configured_compiler();
+    std::istringstream in(command_output(compiler+" -xc++ -E -v - </dev/null 2>&1 >/dev/null"));
+    std::string ln;
+    bool search_list = false;
+    while (std::getline(in, ln)) {
+        if (ln.compare(0, 30, "#include <...> search starts h") == 0) search_list = true;
+        else if (ln.compare(0, 19, "End of search list.") == 0) break;
+        else if (search_list && !ln.empty() && ln[0] == ' ') {
+            ln.erase(0, ln.find_first_not_of(' '));
+            //macOS frameworks are not searched as plain directories
+            if (ln.find(" (framework directory)") != ln.npos) continue;
+            std::string dir = path(ln).lexically_normal().string();
+            if (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+            out.push_back(dir);
+        }
+    }
+    if (out.empty()) std::cerr << "Include search list of the compiler (" << compiler << ") is not available\n";
+    return out;
+}
+
+///Parses files of the graph from first to the end in parallel
+static void scan_files(IncludeGraph &g, std::size_t first, std::vector<std::vector<IncludeDirective> > &directives) {
+    directives.clear();
+    directives.resize(g.files.size()-first);
+    std::atomic<std::size_t> next(first);
+    auto worker = [&]{
+        for (std::size_t i = next++; i < g.files.size(); i = next++) {
+            scan_includes(g.files[i], directives[i-first]);
+        }
+    };
+    std::vector<std::thread> threads;
+    unsigned int count = std::max(1U, std::min(std::thread::hardware_concurrency(), 16U));
+    for (unsigned int i = 1; i < count; i++) threads.emplace_back(worker);
+    worker();
+    for (auto &t: threads) t.join();
+}
+
+///Builds include graph of all sources in src/
+static IncludeGraph build_include_graph() {
+    using namespace std::filesystem;
+    IncludeGraph g;
+    //<...> includes of the project are relative to src/ and to src/ of the imported libraries
+    std::vector<std::string> roots = {src.string()};
+    for (auto iter = recursive_directory_iterator(src); iter != recursive_directory_iterator(); ++iter) {
+        const path &p = iter->path();
+        std::string fname = p.filename().string();
+        if (iter->is_directory()) {
+            if (!fname.empty() && fname[0] == '.') iter.disable_recursion_pending();
+            continue;
+        }
+        if (fname == "library.cmake") roots.push_back((p.parent_path()/"src").string());
+        bool is_source = is_source_file(p);
+        if (is_source || is_header_file(p)) g.add(p.string(), iter->file_size(), true, is_source);
+    }
+    auto sysdirs = system_include_dirs();
+    //<...> includes resolve the same regardless of the including file
+    std::unordered_map<std::string, int> angle_cache;
+    auto resolve_angle = [&](const std::string &name) {
+        auto iter = angle_cache.find(name);
+        if (iter != angle_cache.end()) return iter->second;
+        int id = -1;
+        for (const auto &r: roots) {
+            auto f = g.index.find(path(r+"/"+name).lexically_normal().string());
+            if (f != g.index.end()) {
+                id = f->second;
+                break;
+            }
+        }
+        for (std::size_t i = 0; id < 0 && i < sysdirs.size(); i++) {
+            std::string f = sysdirs[i]+"/"+name;
+            auto known = g.index.find(f);
+            if (known != g.index.end()) {
+                id = known->second;
+            } else {
+                std::error_code ec;
+                auto size = file_size(f, ec);
+                if (!ec) id = g.add(f, size, false, false);
+            }
+        }
+        angle_cache.emplace(name, id);
+        return id;
+    };
+
+    std::vector<std::vector<IncludeDirective> > directives;
+    //each pass scans files found by the previous pass (external headers)
+    for (std::size_t first = 0; first < g.files.size();) {
+        std::size_t end = g.files.size();
+        scan_files(g, first, directives);
+        for (std::size_t i = first; i < end; i++) {
+            std::string dir = path(g.files[i]).parent_path().string();
+            for (auto &d: directives[i-first]) {
+                int id = -1;
+                if (!d.angle) {
+                    std::string f = dir+"/"+d.name;
+                    if (d.name.find("./") != d.name.npos) f = path(f).lexically_normal().string();
+                    auto iter = g.index.find(f);
+                    if (iter != g.index.end()) {
+                        id = iter->second;
+                    } else if (!g.project[i]) {
+                        std::error_code ec;
+                        auto size = file_size(f, ec);
+                        if (!ec) id = g.add(f, size, false, false);
+                    }
+                }
+                if (id < 0) id = resolve_angle(d.name);
+                if (id >= 0 && id != static_cast<int>(i)) g.includes[i].emplace_back(id, std::move(d));
+            }
+        }
+        first = end;
+    }
+    return g;
+}
+
+///Visits files transitively included by the file, fn is called once for each of them (including the file)
+template<typename Fn>
+static void visit_includes(const IncludeGraph &g, int file, std::vector<unsigned int> &stamp, unsigned int gen,
+                           std::vector<int> &stack, Fn &&fn) {
+    stack.clear();
+    stack.push_back(file);
+    stamp[file] = gen;
+    while (!stack.empty()) {
+        int f = stack.back();
+        stack.pop_back();
+        fn(f);
+        for (const auto &inc: g.includes[f]) {
+            if (stamp[inc.first] != gen) {
+                stamp[inc.first] = gen;
+                stack.push_back(inc.first);
+            }
+        }
+    }
+}
+
+///Header ranked by the analyzer
+struct HeaderCost {
+    int file;
+    ///Count of translation units including the header (directly or indirectly)
+    unsigned int units = 0;
+    ///Size of the header and all headers it includes
+    std::uintmax_t transitive = 0;
+    double score() const {return static_cast<double>(units) * static_cast<double>(transitive);}
+};
+
+///Generates <target>_pch.h with headers included by most of the sources of the target and adds it to the CMakeLists.txt
+static bool apply_pch(const IncludeGraph &g, const std::filesystem::path &dir, const std::string &target,
+                      const std::vector<int> &units, const std::vector<std::uintmax_t> &transitive, std::size_t top) {
+    //<...> includes of headers outside of src/, so the header is not rebuilt by changes of the project
+    std::map<std::string, std::pair<unsigned int, int> > candidates;
+    for (int u: units) {
+        std::map<std::string, int> direct;
+        for (const auto &inc: g.includes[u]) {
+            if (!inc.second.angle || g.project[inc.first]) continue;
+            direct.emplace(inc.second.name, inc.first);
+        }
+        for (const auto &d: direct) {
+            auto &c = candidates[d.first];
+            c.first++;
+            c.second = d.second;
+        }
+    }
+    std::vector<std::pair<std::string, double> > selected;
+    unsigned int min_units = std::max<unsigned int>(2, (static_cast<unsigned int>(units.size())+1)/2);
+    for (const auto &c: candidates) {
+        if (c.second.first >= min_units) {
+            selected.emplace_back(c.first, static_cast<double>(c.second.first) * static_cast<double>(transitive[c.second.second]));
+        }
+    }
+    if (selected.empty()) return false;
+    std::sort(selected.begin(), selected.end(), [](const auto &a, const auto &b){return a.second > b.second;});
+    if (selected.size() > top) selected.resize(top);
+
+    std::string pch_name = target+"_pch.h";
+    std::ofstream f(dir/pch_name, std::ios::out|std::ios::trunc);
+    f << "// Precompiled header of the target " << target << ", generated by 'cxxproject analyze includes --apply'\n";
+    f << "// Headers included by most of the sources of the target, which are not part of the project\n";
+    f << "#pragma once\n\n";
+    for (const auto &s: selected) f << "#include <" << s.first << ">\n";
+    f.close();
+
+    auto cmake = (dir/CMakeLists).string();
+    auto lines = read_lines(cmake);
+    std::string ln = "target_precompile_headers(" + target + " PRIVATE " + pch_name + ")";
+    if (std::find(lines.begin(), lines.end(), ln) == lines.end()) {
+        lines.push_back(ln);
+        write_lines(cmake, lines);
+    }
+    std::cout << "  " << target << ": " << (dir/pch_name).string() << " (" << selected.size() << " headers)\n";
+    return true;
+}
+
+///Scans include directives of all sources in src/ and ranks headers by their cost
+static int analyze_includes(Batch &batch, std::size_t top, bool apply) {
+    using namespace std::filesystem;
+    if (!exists(src)) throw std::runtime_error("Current directory is not a root of a project");
+    auto start = std::chrono::steady_clock::now();
+    IncludeGraph g = build_include_graph();
+    auto scanned = std::chrono::steady_clock::now();
+
+    std::vector<unsigned int> stamp(g.files.size(), 0);
+    unsigned int gen = 0;
+    std::vector<int> stack;
+    std::vector<HeaderCost> costs(g.files.size());
+    for (std::size_t i = 0; i < g.files.size(); i++) costs[i].file = static_cast<int>(i);
+    unsigned int unit_count = 0;
+    for (std::size_t i = 0; i < g.files.size(); i++) {
+        if (!g.source[i]) continue;
+        unit_count++;
+        visit_includes(g, static_cast<int>(i), stamp, ++gen, stack, [&](int f){costs[f].units++;});
+    }
+    std::vector<std::uintmax_t> transitive(g.files.size(), 0);
+    for (std::size_t i = 0; i < g.files.size(); i++) {
+        if (g.source[i] || !costs[i].units) continue;
+        std::uintmax_t sum = 0;
+        visit_includes(g, static_cast<int>(i), stamp, ++gen, stack, [&](int f){sum += g.sizes[f];});
+        costs[i].transitive = transitive[i] = sum;
+    }
+    auto ranked = costs;
+    ranked.erase(std::remove_if(ranked.begin(), ranked.end(), [&](const HeaderCost &c){
+        return g.source[c.file] || !c.units;
+    }), ranked.end());
+    std::sort(ranked.begin(), ranked.end(), [](const HeaderCost &a, const HeaderCost &b){return a.score() > b.score();});
+    if (ranked.size() > top) ranked.resize(top);
+    auto ranked_time = std::chrono::steady_clock::now();
+
+    auto ms = [](auto d){return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();};
+    std::size_t project_files = std::count(g.project.begin(), g.project.end(), true);
+    std::cout << "Scanned " << project_files << " files of the project and " << g.files.size()-project_files
+              << " external headers in " << ms(scanned-start) << " ms (ranked in " << ms(ranked_time-scanned) << " ms)\n\n";
+    std::cout << "Headers by translation units x transitive size:\n";
+    std::cout << "     units  transitive KB        score  header\n";
+    for (const auto &c: ranked) {
+        char buff[64];
+        snprintf(buff, sizeof(buff), "%10u %15.1f %12.0f  ", c.units, c.transitive/1024.0, c.score()/1024.0);
+        std::cout << buff << g.files[c.file] << "\n";
+    }
+    std::cout << "(" << unit_count << " translation units, score in KB parsed)\n";
+
+    if (apply) {
+        //targets generated by create_lib_cmake() and create_exec_cmake()
+        std::cout << "\nPrecompiled headers:\n";
+        bool any = false;
+        for (auto iter = recursive_directory_iterator(src); iter != recursive_directory_iterator(); ++iter) {
+            if (!iter->is_directory()) continue;
+            const path &dir = iter->path();
+            std::string fname = dir.filename().string();
+            if (!fname.empty() && fname[0] == '.') {
+                iter.disable_recursion_pending();
+                continue;
+            }
+            //imported libraries are not modified
+            if (exists(dir/"library.cmake") || exists(dir/".git")) {
+                iter.disable_recursion_pending();
+                continue;
+            }
+            if (!exists(dir/CMakeLists)) continue;
+            std::string target;
+            for (const auto &l: read_lines((dir/CMakeLists).string())) {
+                for (std::string_view cmd: {"add_library(", "add_executable("}) {
+                    if (target.empty() && l.compare(0, cmd.size(), cmd) == 0) {
+                        std::istringstream args(l.substr(cmd.size()));
+                        args >> target;
+                        auto paren = target.find(')');
+                        if (paren != target.npos) target.resize(paren);
+                        //header-only libraries have no sources
+                        if (l.find(" INTERFACE") != l.npos) target = "-";
+                    }
+                }
+            }
+            if (target.empty() || target == "-" || target.find('$') != target.npos) continue;
+            std::string prefix = dir.string()+"/";
+            std::vector<int> units;
+            for (std::size_t i = 0; i < g.files.size(); i++) {
+                if (g.source[i] && g.files[i].compare(0, prefix.size(), prefix) == 0) units.push_back(static_cast<int>(i));
+            }
+            if (apply_pch(g, dir, target, units, transitive, top)) {
+                any = true;
+                git_add(batch, dir.string());
+            }
+        }
+        if (!any) std::cout << "  none - no target has headers included by most (at least 2) of its sources\n";
+    }
+    return 0;
+}
+
+///Set by SIGINT/SIGTERM to stop the watch loop
+static volatile sig_atomic_t watch_stop = 0;
+
+///Kind of change detected by the watch, later kinds include the previous ones
+enum class WatchChange {
+    none,
+    ///Configuration files of the program, which only needs to be restarted
+    conf,
+    ///Sources, which are rebuilt
+    source,
+    ///CMakeLists.txt or a CMake module, the build tree is regenerated
+    cmake,
+    ///The build profile, the build tree is configured from scratch
+    profile
+};
+
+///inotify watches of the source tree
+class SourceWatch {
+public:
+    SourceWatch() : fd(inotify_init1(IN_CLOEXEC|IN_NONBLOCK)) {
+        if (fd < 0) throw std::runtime_error("inotify is not available");
+    }
+    ~SourceWatch() {close(fd);}
+    SourceWatch(const SourceWatch &) = delete;
+    SourceWatch &operator=(const SourceWatch &) = delete;
+
+    ///Watches the directory and (if recursive) all its subdirectories except hidden ones (.git)
+    void add(const std::filesystem::path &dir, bool recursive) {
+        using namespace std::filesystem;
+        std::error_code ec;
+        if (!is_directory(dir, ec)) return;
+        int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_CREATE|IN_DELETE);
+        if (wd < 0) throw std::runtime_error("Unable to watch "+dir.string()+" (increase fs.inotify.max_user_watches)");
+        dirs[wd] = {dir, recursive};
+        if (!recursive) return;
+        for (const auto &e: directory_iterator(dir, ec)) {
+            std::string fname = e.path().filename().string();
+            if (e.is_directory(ec) && !e.is_symlink(ec) && fname[0] != '.') add(e.path(), true);
+        }
+    }
+
+    ///Waits up to timeout ms (-1 - forever) for changes, returns false if interrupted by a signal
+    bool wait(int timeout) {
+        pollfd p = {fd, POLLIN, 0};
+        return poll(&p, 1, timeout) > 0;
+    }
+
+    ///Reads pending events and returns kind of the change (profile is a path of the build profile relative to the project)
+    WatchChange read(const std::string &profile, std::string &changed) {
+        using namespace std::filesystem;
+        WatchChange out = WatchChange::none;
+        alignas(inotify_event) char buff[16384];
+        ssize_t len;
+        while ((len = ::read(fd, buff, sizeof(buff))) > 0) {
+            for (char *p = buff; p < buff+len; p += sizeof(inotify_event)+reinterpret_cast<inotify_event *>(p)->len) {
+                auto *ev = reinterpret_cast<inotify_event *>(p);
+                auto iter = dirs.find(ev->wd);
+                if (iter == dirs.end() || !ev->len) continue;
+                std::string fname = ev->name;
+                path file = (iter->second.first/fname).lexically_normal();
+                if (ev->mask & IN_ISDIR) {
+                    if (iter->second.second && fname[0] != '.' && (ev->mask & (IN_CREATE|IN_MOVED_TO))) add(file, true);
+                    continue;
+                }
+                //temporary files of editors
+                if (fname[0] == '.' || fname.back() == '~' || fname == "4913"
+                    || (fname.size() > 4 && fname.compare(fname.size()-4, 3, ".sw") == 0)) continue;
+                WatchChange change = WatchChange::none;
+                std::string top = file.begin()->string();
+                if (file.string() == profile) change = WatchChange::profile;
+                else if (fname == CMakeLists || fname == "library.cmake" || file.extension() == ".cmake") change = WatchChange::cmake;
+                else if (top == "src" || top == "version") change = WatchChange::source;
+                else if (top == "conf") change = WatchChange::conf;
+                if (change == WatchChange::none) continue;
+                if (change > out) out = change;
+                changed = file.string();
+            }
+        }
+        return out;
+    }
+
+private:
+    int fd;
+    std::map<int, std::pair<std::filesystem::path, bool> > dirs;
+};
+
+///Running program started by the watch
+class WatchedProgram {
+public:
+    ~WatchedProgram() {stop();}
+
+    ///Starts the program in the build tree, so its conf/, data/ and log/ resolve
+    void start(const std::filesystem::path &dir, const std::string &exe, const std::vector<std::string> &args) {
+        pid = fork();
+        if (pid < 0) throw std::runtime_error("Unable to start the program");
+        if (pid == 0) {
+            //own process group, so the program can be stopped with its children
+            setpgid(0, 0);
+            if (chdir(dir.c_str()) != 0) _exit(127);
+            std::vector<char *> argv;
+            std::string path = "bin/"+exe;
+            argv.push_back(path.data());
+            for (const auto &a: args) argv.push_back(const_cast<char *>(a.c_str()));
+            argv.push_back(nullptr);
+            execv(path.c_str(), argv.data());
+            _exit(127);
+        }
+        setpgid(pid, pid);
+    }
+
+    ///Stops the program (SIGTERM, SIGKILL after 2 s)
+    void stop() {
+        if (pid <= 0) return;
+        kill(-pid, SIGTERM);
+        for (int i = 0; i < 200 && !reap(); i++) usleep(10000);
+        if (pid > 0) {
+            kill(-pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            pid = 0;
+        }
+    }
+
+    ///Reports exit of the program, returns true if it is not running
+    bool reap() {
+        if (pid <= 0) return true;
+        int status;
+        if (waitpid(pid, &status, WNOHANG) != pid) return false;
+        if (WIFEXITED(status)) std::cout << "[watch] program exited with status " << WEXITSTATUS(status) << std::endl;
+        else if (WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM) std::cout << "[watch] program killed by signal " << WTERMSIG(status) << std::endl;
+        pid = 0;
+        return true;
+    }
+
+private:
+    pid_t pid = 0;
+};
+
+///Runs the command, returns false if it fails, sets watch_stop if the command is interrupted by Ctrl-C
+static bool watch_command(const std::string &cmd) {
+    int status = system(cmd.c_str());
+    if (status != -1 && WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) watch_stop = 1;
+    if (status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 128+SIGINT) watch_stop = 1;
+    return status == 0;
+}
+
+///Watches sources of the project and rebuilds one configuration of the current build profile on each change
+static int watch(std::string config, std::string exe, unsigned int debounce, const std::vector<std::string> &args) {
+    using namespace std::filesystem;
+    using clock = std::chrono::steady_clock;
+    if (!exists(src) || !exists("Makefile")) throw std::runtime_error("Current directory is not a root of a project");
+    std::transform(config.begin(), config.end(), config.begin(), tolower);
+    if (config != "debug" && config != "release") throw std::runtime_error("Unknown configuration: "+config+" (expected: debug or release)");
+    std::string config_name = config;
+    config_name[0] = static_cast<char>(toupper(config_name[0]));
+    Generator gen = detect_generator();
+
+    //the first build configures the tree of the selected configuration only
+    std::cout << "[watch] building " << config << std::endl;
+    if (!watch_command("make --no-print-directory all_"+config) && watch_stop) return 1;
+    //build profile selected by the last make (see FORCE_BUILD_PROFILE of the Makefile)
+    std::string profile = "default_build_profile.conf";
+    if (exists(".current_profile.mk")) {
+        for (const auto &l: read_lines(".current_profile.mk")) {
+            if (l.compare(0, 14, "BUILD_PROFILE=") == 0) profile = path(l.substr(14)).lexically_normal().string();
+        }
+    }
+    //build/<profile> as PROFILE_NAME of the Makefile, if build/current is missing
+    std::string profile_name = path(profile).stem().string();
+    std::string_view suffix = "_build_profile";
+    if (profile_name.size() > suffix.size() && profile_name.compare(profile_name.size()-suffix.size(), suffix.size(), suffix) == 0) {
+        profile_name.resize(profile_name.size()-suffix.size());
+    }
+    path tree_root = is_symlink(build/"current")?build/read_symlink(build/"current"):build/profile_name;
+    path tree = tree_root/config;
+    if (!exists(tree)) throw std::runtime_error("Build tree not found: "+tree.string()+" (run make first)");
+    std::string build_cmd = gen == Generator::ninja
+        ? "cmake --build "+tree_root.string()+" --config "+config_name
+        : "make --no-print-directory -C "+tree.string();
+    //profile changes go through the Makefile, which removes the cache and passes arguments of the profile
+    std::string configure_cmd = "make --no-print-directory "+(gen == Generator::ninja?(tree_root/"build.ninja"):(tree/"Makefile")).string();
+    std::string regenerate_cmd = "cmake "+(gen == Generator::ninja?tree_root:tree).string()+" > /dev/null";
+    if (!exe.empty()) {
+        build_cmd += gen == Generator::ninja?" --target "+exe:" "+exe;
+    } else if (exists(tree/"bin")) {
+        //the only executable of the project
+        std::vector<std::string> programs;
+        for (const auto &e: directory_iterator(tree/"bin")) {
+            if (e.is_regular_file()) programs.push_back(e.path().filename().string());
+        }
+        if (programs.size() == 1) {
+            exe = programs[0];
+        } else if (programs.size() > 1) {
+            std::cout << "[watch] select the program to restart by --run <name>:";
+            for (const auto &p: programs) std::cout << " " << p;
+            std::cout << std::endl;
+        }
+    }
+
+    SourceWatch watcher;
+    watcher.add(".", false);
+    watcher.add(src, true);
+    watcher.add(conf, true);
+    watcher.add(cmake_modules, false);
+    watcher.add(profiles, false);
+    watcher.add("version", false);
+
+    struct sigaction sa = {};
+    sa.sa_handler = [](int){watch_stop = 1;};
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    WatchedProgram program;
+    auto run = [&]{
+        if (exe.empty()) return;
+        if (!exists(tree/"bin"/exe)) {
+            std::cout << "[watch] program not found: " << (tree/"bin"/exe).string() << std::endl;
+            return;
+        }
+        program.start(tree, exe, args);
+    };
+    run();
+    std::cout << "[watch] watching src/, conf/ and " CMakeLists " (" << config << ", " << profile << "), Ctrl-C to stop" << std::endl;
+    while (!watch_stop) {
+        if (!watcher.wait(500)) {
+            program.reap();
+            continue;
+        }
+        std::string changed;
+        WatchChange change = watcher.read(profile, changed);
+        if (change == WatchChange::none) continue;
+        auto detected = clock::now();
+        //bursts of saves (save all, formatters, git checkout) are built once
+        while (!watch_stop && watcher.wait(static_cast<int>(debounce))) {
+            std::string more;
+            change = std::max(change, watcher.read(profile, more));
+            if (!more.empty()) changed = more;
+        }
+        if (watch_stop) break;
+        std::cout << "[watch] changed " << changed << std::endl;
+        auto started = clock::now();
+        bool ok = true;
+        if (change == WatchChange::profile) ok = watch_command(configure_cmd);
+        else if (change == WatchChange::cmake) ok = watch_command(regenerate_cmd);
+        if (ok && change >= WatchChange::source) ok = watch_command(build_cmd);
+        auto built = clock::now();
+        if (watch_stop) break;
+        auto ms = [](auto d){return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();};
+        if (!ok) {
+            std::cout << "[watch] build failed after " << ms(built-started) << " ms" << std::endl;
+            continue;
+        }
+        program.stop();
+        run();
+        std::cout << "[watch] " << (change == WatchChange::profile?"reconfigured and rebuilt":change == WatchChange::cmake?"regenerated and rebuilt":
+                                    change == WatchChange::source?"rebuilt":"restarted")
+                  << " in " << ms(built-started) << " ms (" << ms(clock::now()-detected) << " ms from the change)" << std::endl;
+    }
+    program.stop();
+    std::cout << "[watch] stopped" << std::endl;
+    return 0;
+}
+
+///Command line split to positional arguments and --options
+struct CommandLine {
+    std::vector<std::string_view> args;
+    std::map<std::string_view, std::string_view, std::less<> > options;
+    ///Arguments after --
+    std::vector<std::string> rest;
+
+    bool has(std::string_view opt) const {
+        return options.find(opt) != options.end();
+    }
+    std::string_view get(std::string_view opt, std::string_view def = {}) const {
+        auto iter = options.find(opt);
+        return iter == options.end()?def:iter->second;
+    }
+};
+
+static CommandLine parse_command_line(int argc, char **argv) {
+    //options, which takes value from next argument (or --option=value)
+    static const std::string_view value_options[] = {"--generator", "--from", "--depth", "--jobs", "--kind", "--config", "--top", "--run", "--debounce"};
+    CommandLine out;
+    for (int i = 1; i < argc; i++) {
+        std::string_view a = argv[i];
+        if (a == "--") {
+            out.rest.assign(argv+i+1, argv+argc);
+            break;
+        }
+        if (a.size() > 2 && a.substr(0,2) == "--") {
+            auto eq = a.find('=');
+            if (eq != a.npos) {
+                out.options[a.substr(0,eq)] = a.substr(eq+1);
+            } else if (std::find(std::begin(value_options), std::end(value_options), a) != std::end(value_options)) {
+                if (i+1 >= argc) throw std::runtime_error(std::string("Missing value of option: ").append(a));
+                out.options[a] = argv[++i];
+            } else {
+                out.options[a] = {};
+            }
+        } else {
+            out.args.push_back(a);
+        }
+    }
+    return out;
+}
+
+static unsigned int parse_count(const CommandLine &cmd, std::string_view opt) {
+    std::string_view v = cmd.get(opt);
+    if (v.empty() || v.find_first_not_of("0123456789") != v.npos || v.size() > 6) {
+        throw std::runtime_error(std::string("Invalid value of option ").append(opt).append(": ").append(v));
+    }
+    return static_cast<unsigned int>(std::stoul(std::string(v)));
+}
+
+static SubmoduleOptions parse_submodule_options(const CommandLine &cmd) {
+    SubmoduleOptions opts;
+    if (cmd.has("--shallow")) opts.depth = 1;
+    if (cmd.has("--depth")) opts.depth = parse_count(cmd, "--depth");
+    if (cmd.has("--jobs")) opts.jobs = parse_count(cmd, "--jobs");
+    return opts;
+}
+
+///Parses options of the target, target_kind is "executable", "library" or "tests"
+static TargetOptions parse_target_options(const CommandLine &cmd, std::string_view target_kind) {
+    if (target_kind != "library" && cmd.has("--kind")) {
+        throw std::runtime_error("Option --kind is accepted only by libraries, not by "+std::string(target_kind));
+    }
+    TargetOptions opts;
+    opts.unity = cmd.has("--unity");
+    opts.single_binary = cmd.has("--single-binary");
+    if (cmd.has("--kind")) opts.kind = parse_library_kind(cmd.get("--kind"));
+    opts.modules = cmd.has("--modules");
+    opts.tracing = cmd.has("--tracing");
+    return opts;
+}
+
+
+int main(int argc, char **argv) {
+
+    try {
+    CommandLine cmd = parse_command_line(argc, argv);
+    const auto &args = cmd.args;
+    if (!args.empty() || cmd.has("--help")) {
+
+        std::string_view arg1 = args.empty()?std::string_view("--help"):args[0];
+
+        if (arg1 == "-h" || arg1 == "--help") {
+            std::cout << "Usage: cxxproject <command> <args...>\n"
+                    "\n"
+                    "create executable <name>        create C++ executable\n"
+                    "create library <name>           create C++ library\n"
+                    "       --generator make|ninja   build with Unix Makefiles (default)\n"
+                    "                                or with Ninja Multi-Config\n"
+                    "       --unity                  build the main target as unity build\n"
+                    "add library <name>              add empty library\n"
+                    "add library <name> <gitpath>    add library from git\n"
+                    "add library <name> <gitpath> <branch>\n"
+                    "                                add library from git - branch\n"
+                    "                (automatically includes library.cmake if exists)\n"
+                    "       --shallow                fetch the library without history\n"
+                    "       --depth <n>              fetch only last <n> commits\n"
+                    "       --jobs <n>               fetch nested submodules in parallel\n"
+                    "       --kind static|object|shared|interface\n"
+                    "                                kind of the library (default static,\n"
+                    "                                also accepted by create library)\n"
+                    "add executable <name>           add new executable\n"
+                    "       --unity                  build the library/executable as unity build\n"
+                    "       --modules                library is C++20 module instead of header\n"
+                    "                                (also accepted by create library, requires\n"
+                    "                                Ninja generator, CMake 3.28 and Ninja 1.11)\n"
+                    "       --tracing                instrument the executable by tracing library\n"
+                    "                                src/cxxtrace (also accepted by create executable)\n"
+                    "add tests <name>                add new test directory\n"
+                    "       --single-binary          compile all tests into one executable\n"
+                    "                                (also accepted by create library)\n"
+                    "add benchmark <name>            add new benchmark directory\n"
+                    "profile list                    list build profiles\n"
+                    "profile add <name>              add build profile (from template or\n"
+                    "                                copy of default profile)\n"
+                    "       --from <profile>         copy of other profile\n"
+                    "apply <manifest>                create or extend the project by manifest\n"
+                    "build-report                    report compile time collected by profile\n"
+                    "                                build-timing\n"
+                    "       --config debug|release   configuration (default release)\n"
+                    "       --top <n>                count of items of each list (default 20)\n"
+                    "watch                           rebuild on each change of sources and restart the program\n"
+                    "       --config debug|release   configuration to build (default debug)\n"
+                    "       --run <name>             program from bin/ to restart, arguments follow --\n"
+                    "       --debounce <ms>          wait for more changes before building (default 200)\n"
+                    "analyze includes                rank headers by translation units including\n"
+                    "                                them x transitive size\n"
+                    "       --top <n>                count of listed headers (default 20)\n"
+                    "       --apply                  generate precompiled header of each target\n"
+                    "update makefile                 regenerate Makefile of the project\n"
+                    "       --generator make|ninja   switch project to different generator\n";
+            return 0;
+        }
+        if (arg1 == "create") {
+            if (args.size() > 2) {
+                std::string_view arg2 = args[1];
+                std::string_view arg3 = args[2];
+                TargetOptions opts = parse_target_options(cmd, arg2);
+                //modules need Ninja, which is then the default
+                Generator gen = parse_generator(cmd.get("--generator", opts.modules?"ninja":"make"));
+                if (arg2 == "executable") {
+                    return create_exec(std::string(arg3), gen, opts);
+                } else if (arg2 == "library") {
+                    return create_lib(std::string(arg3), gen, opts);
+                }
+            }
         } else if (arg1 == "add") {
-            if (argc > 3) {
-                std::string_view arg2 = argv[2];
-                std::string_view arg3 = argv[3];
+            if (args.size() > 2) {
+                std::string_view arg2 = args[1];
+                std::string_view arg3 = args[2];
                 if (arg2 == "library") {
-                    if (argc > 4) {
-                        std::string_view arg4 = argv[4];
+                    if (args.size() > 3) {
+                        std::string_view arg4 = args[3];
                         std::string_view branch;
-                        if (argc > 5) {
-                            branch = argv[5];
+                        if (args.size() > 4) {
+                            branch = args[4];
                         }
-                        return add_git_lib(std::string(arg3), std::string(arg4), std::string(branch));
+                        return run_batch([&](Batch &batch){
+                            return add_git_lib(batch, std::string(arg3), std::string(arg4), std::string(branch), parse_submodule_options(cmd));
+                        });
                     } else if (arg3.find('/') != arg3.npos){
                         throw std::runtime_error(std::string("Invalid library name: ").append(arg3));;
                     } else {
-                        return add_empty_lib(std::string(arg3));
+                        return run_batch([&](Batch &batch){return add_empty_lib(batch, std::string(arg3), parse_target_options(cmd, arg2));});
                     }
                 }
                 if (arg2 == "executable") {
-                    return add_empty_exec(std::string(arg3));
+                    return run_batch([&](Batch &batch){return add_empty_exec(batch, std::string(arg3), parse_target_options(cmd, arg2));});
                 }
                 if (arg2 == "tests") {
-                    return add_tests(std::string(arg3));
+                    return run_batch([&](Batch &batch){return add_tests(batch, std::string(arg3), parse_target_options(cmd, arg2));});
+                }
+                if (arg2 == "benchmark") {
+                    return run_batch([&](Batch &batch){return add_benchmark(batch, std::string(arg3));});
                 }
             }
+        } else if (arg1 == "profile") {
+            if (args.size() > 1 && args[1] == "list") {
+                return profile_list();
+            }
+            if (args.size() > 2 && args[1] == "add") {
+                return run_batch([&](Batch &batch){return profile_add(batch, std::string(args[2]), std::string(cmd.get("--from")));});
+            }
+        } else if (arg1 == "apply") {
+            if (args.size() > 1) {
+                return apply_manifest(std::string(args[1]));
+            }
+        } else if (arg1 == "analyze") {
+            if (args.size() > 1 && args[1] == "includes") {
+                return run_batch([&](Batch &batch){
+                    return analyze_includes(batch, cmd.has("--top")?parse_count(cmd, "--top"):20, cmd.has("--apply"));
+                });
+            }
+        } else if (arg1 == "watch") {
+            return watch(std::string(cmd.get("--config", "debug")), std::string(cmd.get("--run")),
+                         cmd.has("--debounce")?parse_count(cmd, "--debounce"):200, cmd.rest);
+        } else if (arg1 == "build-report") {
+            return build_report(std::string(cmd.get("--config", "release")), cmd.has("--top")?parse_count(cmd, "--top"):20);
+        } else if (arg1 == "update") {
+            if (args.size() > 1 && args[1] == "makefile") {
+                Generator gen = cmd.has("--generator")?parse_generator(cmd.get("--generator")):detect_generator();
+                return run_batch([&](Batch &batch){return update_makefile(batch, gen);});
+            }
         }
 
     }